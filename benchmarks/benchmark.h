@@ -0,0 +1,73 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <QtCore/qglobal.h>
+#include <chrono>
+#include <cstdio>
+
+// TINY TIMING HARNESS FOR THE BENCHMARK TARGET.  main.cpp REPLACES GLOBAL operator new SO
+// EVERY RESULT ALSO SAYS HOW MANY HEAP ALLOCATIONS ONE OPERATION COST.
+namespace Benchmark
+{
+quint64 allocations();
+
+// KEEPS RESULTS ALIVE SO THE COMPILER CANNOT DROP THE WORK BEING MEASURED
+extern volatile quint64 sink;
+
+struct Result
+{
+    const char *name;
+    quint64 operations;
+    double nanosPerOperation;
+    double allocationsPerOperation;
+};
+
+template <typename Body>
+Result measure(const char *name, quint64 operations, Body body)
+{
+    const quint64 allocationsBefore = allocations();
+    const auto start = std::chrono::steady_clock::now();
+    for (quint64 i = 0; i < operations; ++i)
+        body(i);
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    Result result;
+    result.name = name;
+    result.operations = operations;
+    result.nanosPerOperation = double(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()) / double(operations);
+    result.allocationsPerOperation = double(allocations() - allocationsBefore) / double(operations);
+    return result;
+}
+
+inline void print(const Result &result)
+{
+    std::printf("%-44s %12llu ops %10.1f ns/op %8.2f allocs/op\n", result.name,
+                static_cast<unsigned long long>(result.operations), result.nanosPerOperation, result.allocationsPerOperation);
+}
+
+// LIMITS FOR A RELEASE GATE, NEGATIVE FOR NONE
+struct PipelineBudget
+{
+    double nanosPerEdge = -1;
+    double allocationsPerNotification = -1;
+};
+
+inline void section(const char *title)
+{
+    std::printf("\n%s\n", title);
+}
+}
+
+void runEncoderBenchmarks();
+// FALSE WHEN THE RUNNING SPEED ESTIMATOR TRACKS A PROFILE TOO INACCURATELY, SETTLES TOO SLOWLY
+// OR SEES A STOP NO EARLIER THAN THE OLD CALCULATION
+bool runEstimatorBenchmarks();
+void runCaptureBenchmarks();
+void runTelemetryBenchmarks();
+// FALSE WHEN THE CONFIGURED FILTER MISCOUNTS A BOUNCY TRACE
+bool runFilterBenchmarks();
+// FALSE WHEN THE EVENT TIME COUNTER DISAGREES WITH THE DIRECT CONVERSION UNDER THE FAKE CLOCK
+bool runTimebaseBenchmarks();
+// FALSE WHEN A PROFILE WENT OVER THE BUDGET
+bool runPipelineBenchmarks(const Benchmark::PipelineBudget &budget);
+
+#endif // BENCHMARK_H
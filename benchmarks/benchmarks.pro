@@ -0,0 +1,20 @@
+TEMPLATE = app
+TARGET = benchmarks.bin
+
+QT = core bluetooth
+CONFIG += c++11 console
+
+HEADERS += benchmark.h
+
+SOURCES += main.cpp \
+           capturebenchmark.cpp \
+           encoderbenchmark.cpp \
+           estimatorbenchmark.cpp \
+           filterbenchmark.cpp \
+           pipelinebenchmark.cpp \
+           telemetrybenchmark.cpp \
+           timebasebenchmark.cpp
+
+# ONLY THE HARDWARE INDEPENDENT PARTS OF common/ ARE BENCHMARKED, SO THIS BUILDS AND RUNS
+# ANYWHERE.  THE SERVICES NEED THE BLUETOOTH MODULE BUT NO ADAPTER
+include(../common/common-sources.pri)
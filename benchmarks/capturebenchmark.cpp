@@ -0,0 +1,200 @@
+#include "benchmark.h"
+#include "edgecapture.h"
+#include "simulatedsensorinput.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <time.h>
+#include <vector>
+
+namespace
+{
+const int WHEEL_PIN = 8;
+// A FAST WHEEL: 40 EDGES A SECOND, EACH PULSE ONLY A FEW SAMPLES LONG
+const double WHEEL_RPM = 2400;
+const int POLLING_INTERVAL_MILLIS = 1;
+const int RUN_SECONDS = 2;
+// HOW OFTEN THE BENCHMARK DRAINS THE RING, STANDING IN FOR THE QT EVENT LOOP
+const int DRAIN_MILLIS = 10;
+const int IDLE_POLLING_INTERVAL_MILLIS = 50;
+// SHORTER THAN THE DAEMON'S DEFAULT SO A RUN REACHES THE IDLE STATE
+const int IDLE_AFTER_MILLIS = 500;
+// SLOW ENOUGH THAT THE FIRST PULSE OUTLASTS AN IDLE PERIOD
+const double STARTING_WHEEL_RPM = 240;
+
+struct Run
+{
+    const char *name;
+    bool realTime;
+    bool loaded;
+};
+
+// KEEPS EVERY CPU BUSY AT NORMAL PRIORITY, LIKE A BUSY BOARD
+class Load
+{
+public:
+    explicit Load(bool enabled)
+    {
+        if (!enabled)
+            return;
+        const unsigned count = qMax(1u, std::thread::hardware_concurrency());
+        for (unsigned i = 0; i < count; ++i)
+        {
+            threads.emplace_back([this]() {
+                while (!stopping.load(std::memory_order_relaxed))
+                    Benchmark::sink = Benchmark::sink + 1;
+            });
+        }
+    }
+    ~Load()
+    {
+        stopping = true;
+        for (std::thread &thread : threads)
+            thread.join();
+    }
+
+private:
+    std::atomic<bool> stopping{false};
+    std::vector<std::thread> threads;
+};
+
+struct IdleRun
+{
+    const char *name;
+    int idleIntervalMillis;
+    bool listening;
+    // WHEN THE WHEEL STARTS TURNING, NEGATIVE FOR NEVER
+    int startMillis;
+};
+
+qint64 cpuNanos()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return qint64(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+void run(const Run &settings)
+{
+    SimulatedSensorInput input;
+    QVector<SimulatedSensorInput::ProfilePoint> profile;
+    SimulatedSensorInput::ProfilePoint point;
+    point.atNanos = 0;
+    point.rpm = WHEEL_RPM;
+    profile << point;
+    input.setProfile(WHEEL_PIN, profile);
+
+    EdgeCapture capture(input, EdgeCapture::PollingMode, qint64(POLLING_INTERVAL_MILLIS) * 1000000);
+    EdgeCapture::RealTimeSettings realTime;
+    realTime.enabled = settings.realTime;
+    capture.setRealTime(realTime);
+    capture.addPin(WHEEL_PIN);
+    quint64 edges = 0;
+    Load load(settings.loaded);
+    if (!capture.start([&edges](int, qint64) { ++edges; }))
+    {
+        std::printf("%-28s capture did not start\n", settings.name);
+        return;
+    }
+
+    // ONLY THE CAPTURE THREAD AND THE DRAIN LOOP RUN FROM HERE, SO EVERY ALLOCATION IS THEIRS
+    const quint64 allocationsBefore = Benchmark::allocations();
+    const auto end = std::chrono::steady_clock::now() + std::chrono::seconds(RUN_SECONDS);
+    while (std::chrono::steady_clock::now() < end)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(DRAIN_MILLIS));
+        capture.drain();
+    }
+    const quint64 allocations = Benchmark::allocations() - allocationsBefore;
+    const bool realTimeActive = capture.realTimeActive();
+    capture.stop();
+    capture.drain();
+
+    const Histogram &lateness = capture.wakeLateness();
+    const quint64 expected = quint64(WHEEL_RPM / 60 * RUN_SECONDS);
+    std::printf("%-28s %-9s wakeups %6llu  lateness p50 %6.1f us p99 %7.1f us max %8.1f us  edges %4llu/%llu  allocs %llu\n",
+                settings.name, settings.realTime ? (realTimeActive ? "sched" : "denied") : "normal",
+                static_cast<unsigned long long>(lateness.count()), lateness.quantileNanos(0.5) / 1e3,
+                lateness.quantileNanos(0.99) / 1e3, lateness.maxNanos() / 1e3,
+                static_cast<unsigned long long>(edges), static_cast<unsigned long long>(expected),
+                static_cast<unsigned long long>(allocations));
+}
+
+void runIdle(const IdleRun &settings)
+{
+    SimulatedSensorInput input;
+    QVector<SimulatedSensorInput::ProfilePoint> profile;
+    SimulatedSensorInput::ProfilePoint point;
+    point.atNanos = 0;
+    point.rpm = 0;
+    profile << point;
+    if (settings.startMillis >= 0)
+    {
+        point.atNanos = qint64(settings.startMillis) * 1000000;
+        profile << point;
+        point.atNanos += 1;
+        point.rpm = STARTING_WHEEL_RPM;
+        profile << point;
+    }
+    input.setProfile(WHEEL_PIN, profile);
+
+    EdgeCapture capture(input, EdgeCapture::PollingMode, qint64(POLLING_INTERVAL_MILLIS) * 1000000);
+    EdgeCapture::IdleSettings idle;
+    idle.intervalMillis = settings.idleIntervalMillis;
+    idle.afterMillis = IDLE_AFTER_MILLIS;
+    capture.setIdle(idle);
+    capture.setListening(settings.listening);
+    capture.addPin(WHEEL_PIN);
+    quint64 edges = 0;
+    if (!capture.start([&edges](int, qint64) { ++edges; }))
+    {
+        std::printf("%-38s capture did not start\n", settings.name);
+        return;
+    }
+    // THE DRAIN LOOP COSTS THE SAME IN EVERY RUN, SO DIFFERENCES ARE THE CAPTURE THREAD'S
+    const qint64 cpuBefore = cpuNanos();
+    const auto end = std::chrono::steady_clock::now() + std::chrono::seconds(RUN_SECONDS);
+    while (std::chrono::steady_clock::now() < end)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(DRAIN_MILLIS));
+        capture.drain();
+    }
+    const qint64 cpu = cpuNanos() - cpuBefore;
+    capture.stop();
+    capture.drain();
+
+    const EdgeCapture::Stats stats = capture.stats();
+    const quint64 expected = settings.startMillis < 0
+                                 ? 0
+                                 : quint64(STARTING_WHEEL_RPM / 60 * (RUN_SECONDS * 1000 - settings.startMillis) / 1000);
+    std::printf("%-38s wakeups/s %6.0f (%5.1f%% idle)  cpu %6.3f%%  edges %llu/%llu\n", settings.name,
+                double(stats.wakeups) / RUN_SECONDS, stats.wakeups ? 100.0 * double(stats.idleWakeups) / double(stats.wakeups) : 0,
+                100.0 * double(cpu) / (RUN_SECONDS * 1e9), static_cast<unsigned long long>(edges),
+                static_cast<unsigned long long>(expected));
+}
+}
+
+void runCaptureBenchmarks()
+{
+    Benchmark::section("polling capture jitter, 1 ms period, simulated 2400 rpm wheel (real-time needs CAP_SYS_NICE)");
+    const Run runs[] = {
+        { "normal, idle", false, false },
+        { "normal, all cpus busy", false, true },
+        { "real-time, idle", true, false },
+        { "real-time, all cpus busy", true, true }
+    };
+    for (const Run &settings : runs)
+        run(settings);
+
+    Benchmark::section("idle polling, 1 ms period, 50 ms idle period after 500 ms without an edge");
+    const IdleRun idleRuns[] = {
+        { "full rate, standing still", 0, true, -1 },
+        { "idle, nobody subscribed", IDLE_POLLING_INTERVAL_MILLIS, false, -1 },
+        { "idle, nobody subscribed, wheel at 1 s", IDLE_POLLING_INTERVAL_MILLIS, false, 1000 },
+        { "idle, subscribed, standing still", IDLE_POLLING_INTERVAL_MILLIS, true, -1 },
+        { "idle, subscribed, wheel starts at 1 s", IDLE_POLLING_INTERVAL_MILLIS, true, 1000 }
+    };
+    for (const IdleRun &settings : idleRuns)
+        runIdle(settings);
+}
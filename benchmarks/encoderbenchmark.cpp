@@ -0,0 +1,86 @@
+#include "benchmark.h"
+#include "measurementencoder.h"
+
+#include <QtCore/qbytearray.h>
+
+namespace
+{
+const quint64 OPERATIONS = 5000000;
+
+// THE ENCODER THE SERVICES USED BEFORE: A FRESH QBYTEARRAY PER TICK, MILLISECONDS % 256 AS
+// EVENT TIME AND THE TOP BYTE OF THE WHEEL COUNT DROPPED
+QByteArray legacyCscEncode(unsigned int numberOfRevolutions, unsigned int numberOfCranks, unsigned long wheelMillis, unsigned long crankMillis)
+{
+    unsigned short lowRevBit = numberOfRevolutions % 256;
+    unsigned short midRevBit = numberOfRevolutions / 256 % 256;
+    unsigned short highRevBit = numberOfRevolutions / (256 * 256);
+    unsigned short lowCrankBit = numberOfCranks % 256;
+    unsigned short highCrankBit = numberOfCranks / 256 % 256;
+    QByteArray value;
+    value.append(char(3));
+    value.append(char(lowRevBit));
+    value.append(char(midRevBit));
+    value.append(char(highRevBit));
+    value.append(char(0));
+    value.append(char(wheelMillis % 256));
+    value.append(char(wheelMillis / 256 % 256));
+    value.append(char(lowCrankBit));
+    value.append(char(highCrankBit));
+    value.append(char(crankMillis % 256));
+    value.append(char(crankMillis / 256 % 256));
+    return value;
+}
+
+QByteArray legacyRscEncode(unsigned int revolutions, unsigned long millis)
+{
+    const double metersPerSecond = double(revolutions) * 133 / double(millis);
+    const double whole = double(qint64(metersPerSecond));
+    QByteArray value;
+    value.append(char(0));
+    value.append(char(short((metersPerSecond - whole) * 256)));
+    value.append(char(short(whole)));
+    value.append(char(0));
+    return value;
+}
+}
+
+void runEncoderBenchmarks()
+{
+    typedef CscMeasurementEncoder<CscMeasurement::WheelRevolutionDataPresent | CscMeasurement::CrankRevolutionDataPresent> CscBothEncoder;
+    typedef RscMeasurementEncoder<RscMeasurement::InstantaneousStrideLengthPresent | RscMeasurement::TotalDistancePresent> RscFullEncoder;
+
+    Benchmark::section("MEASUREMENT ENCODING");
+    Benchmark::print(Benchmark::measure("csc legacy QByteArray::append", OPERATIONS, [](quint64 i) {
+        const QByteArray value = legacyCscEncode(unsigned(i), unsigned(i / 3), i * 7, i * 11);
+        Benchmark::sink += quint64(value.constData()[1]);
+    }));
+
+    char packet[MAX_MEASUREMENT_SIZE];
+    CscMeasurement csc;
+    Benchmark::print(Benchmark::measure("csc template encode", OPERATIONS, [&](quint64 i) {
+        csc.cumulativeWheelRevolutions = quint32(i);
+        csc.lastWheelEventTime = MeasurementEncoding::eventTime(qint64(i) * 7000000);
+        csc.cumulativeCrankRevolutions = quint16(i / 3);
+        csc.lastCrankEventTime = MeasurementEncoding::eventTime(qint64(i) * 11000000);
+        Benchmark::sink += quint64(packet[CscBothEncoder::encode(csc, packet) - 1]);
+    }));
+    Benchmark::print(Benchmark::measure("csc template encode + notify copy", OPERATIONS, [&](quint64 i) {
+        csc.cumulativeWheelRevolutions = quint32(i);
+        const QByteArray value(packet, CscBothEncoder::encode(csc, packet));
+        Benchmark::sink += quint64(value.constData()[1]);
+    }));
+
+    Benchmark::print(Benchmark::measure("rsc legacy QByteArray::append", OPERATIONS, [](quint64 i) {
+        const QByteArray value = legacyRscEncode(unsigned(i % 11), 1000 + i % 7);
+        Benchmark::sink += quint64(value.constData()[1]);
+    }));
+    RscMeasurement rsc;
+    rsc.instantaneousCadence = 170;
+    rsc.running = true;
+    Benchmark::print(Benchmark::measure("rsc template encode (stride + distance)", OPERATIONS, [&](quint64 i) {
+        rsc.instantaneousSpeed = quint16(i);
+        rsc.instantaneousStrideLength = quint16(i / 5);
+        rsc.totalDistance = quint32(i);
+        Benchmark::sink += quint64(packet[RscFullEncoder::encode(rsc, packet) - 1]);
+    }));
+}
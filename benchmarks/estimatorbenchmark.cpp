@@ -0,0 +1,240 @@
+#include "benchmark.h"
+#include "speedestimator.h"
+
+#include <QtCore/qvector.h>
+#include <cmath>
+#include <cstdio>
+
+namespace
+{
+// DISTANCE TRAVELLED IN ONE REVOLUTION OF THE TREADMILL IN MILLIMETERS
+const int DISTANCE_PER_REVOLUTION = 133;
+// HOW OFTEN THE REPLAY SAMPLES THE ESTIMATE, LIKE A CLIENT READING NOTIFICATIONS
+const qint64 SAMPLE_NANOS = 100000000;
+// A STEP IS TRACKED ONCE THE ESTIMATE IS WITHIN THIS FRACTION OF THE NEW SPEED
+const double SETTLED = 0.05;
+// NEITHER ESTIMATOR HAS A SPEED UNTIL IT HAS SEEN A FEW EDGES, SO ERRORS ARE COUNTED AFTER THIS
+const qint64 WARM_UP_NANOS = 2000000000;
+// THE ESTIMATOR WITH ITS DEFAULT SETTINGS FAILS THE BENCHMARK TARGET WHEN ANY PROFILE TRACKS
+// WORSE THAN THIS ON AVERAGE OR SETTLES SLOWER, ABOUT TWICE WHAT IT DOES TODAY
+const double MAX_MEAN_ERROR = 0.1;
+const double MAX_SETTLE_SECONDS = 3;
+
+struct Segment
+{
+    double seconds;
+    double fromMetersPerSecond;
+    double toMetersPerSecond;
+};
+
+struct Profile
+{
+    const char *name;
+    QVector<Segment> segments;
+};
+
+double speedAt(const Profile &profile, double seconds)
+{
+    for (const Segment &segment : profile.segments)
+    {
+        if (seconds < segment.seconds)
+            return segment.fromMetersPerSecond + (segment.toMetersPerSecond - segment.fromMetersPerSecond) * seconds / segment.seconds;
+        seconds -= segment.seconds;
+    }
+    return profile.segments.last().toMetersPerSecond;
+}
+
+double duration(const Profile &profile)
+{
+    double seconds = 0;
+    for (const Segment &segment : profile.segments)
+        seconds += segment.seconds;
+    return seconds;
+}
+
+// THE RSC CALCULATION THE SERVICE USED BEFORE: REVOLUTIONS SINCE THE LAST REPORT OVER THE TIME
+// SINCE IT, REPORTED AFTER 1 SECOND OR 10 REVOLUTIONS AND HELD IN BETWEEN
+class LegacyEstimator
+{
+public:
+    void addEdge(qint64 nanos)
+    {
+        revolutions += 1;
+        if (revolutions == 10)
+            report(nanos);
+    }
+    void update(qint64 nanos)
+    {
+        if (nanos - lastReport > 1000000000)
+            report(nanos);
+    }
+    double metersPerSecond() const { return speed; }
+
+private:
+    void report(qint64 nanos)
+    {
+        speed = double(revolutions) * DISTANCE_PER_REVOLUTION / double((nanos - lastReport) / 1000000);
+        revolutions = 0;
+        lastReport = nanos;
+    }
+    unsigned revolutions = 0;
+    qint64 lastReport = 0;
+    double speed = 0;
+};
+
+struct Accuracy
+{
+    double meanError = 0;
+    double maxError = 0;
+    // seconds from the start of the last segment until the estimate settles, -1 if never.  WHEN
+    // THE LAST SEGMENT IS A STANDSTILL THIS IS THE TIME TO DETECT THE STOP
+    double settleSeconds = -1;
+};
+
+// WALKS THE PROFILE, GENERATING A BELT EDGE EVERY DISTANCE_PER_REVOLUTION AND SAMPLING BOTH
+// ESTIMATORS EVERY SAMPLE_NANOS AGAINST THE TRUE SPEED
+template <typename Estimate>
+Accuracy replay(const Profile &profile, Estimate estimate)
+{
+    Accuracy accuracy;
+    const qint64 stepNanos = 100000;
+    const qint64 endNanos = qint64(duration(profile) * 1e9);
+    const qint64 lastSegmentNanos = endNanos - qint64(profile.segments.last().seconds * 1e9);
+    const double finalSpeed = profile.segments.last().toMetersPerSecond;
+    double travelled = 0;
+    double errorSum = 0;
+    int samples = 0;
+    for (qint64 nanos = 0; nanos <= endNanos; nanos += stepNanos)
+    {
+        const double speed = speedAt(profile, double(nanos) / 1e9);
+        travelled += speed * double(stepNanos) / 1e6;
+        const bool edge = travelled >= DISTANCE_PER_REVOLUTION;
+        if (edge)
+            travelled -= DISTANCE_PER_REVOLUTION;
+        if (nanos % SAMPLE_NANOS == 0 || edge)
+        {
+            const double estimated = estimate(nanos, edge);
+            if (nanos % SAMPLE_NANOS != 0 || nanos < WARM_UP_NANOS)
+                continue;
+            const double error = std::fabs(estimated - speed);
+            errorSum += error;
+            accuracy.maxError = qMax(accuracy.maxError, error);
+            ++samples;
+            const bool settled = std::fabs(estimated - finalSpeed) <= SETTLED * qMax(finalSpeed, 0.1);
+            if (nanos >= lastSegmentNanos && settled && accuracy.settleSeconds < 0)
+                accuracy.settleSeconds = double(nanos - lastSegmentNanos) / 1e9;
+            if (!settled)
+                accuracy.settleSeconds = -1;
+        }
+    }
+    accuracy.meanError = samples ? errorSum / samples : 0;
+    return accuracy;
+}
+
+void print(const Profile &profile, const char *estimator, const Accuracy &accuracy)
+{
+    const bool stops = profile.segments.last().toMetersPerSecond == 0;
+    std::printf("%-26s %-10s mean error %6.3f m/s  max error %6.3f m/s  %s %s",
+                profile.name, estimator, accuracy.meanError, accuracy.maxError, stops ? "stop seen" : "settles",
+                accuracy.settleSeconds < 0 ? "never\n" : "");
+    if (accuracy.settleSeconds >= 0)
+        std::printf("%.1f s\n", accuracy.settleSeconds);
+}
+
+bool withinLimits(const Accuracy &accuracy)
+{
+    bool within = true;
+    if (accuracy.meanError > MAX_MEAN_ERROR)
+    {
+        std::printf("    too inaccurate: mean error %.3f m/s, at most %.3f allowed\n", accuracy.meanError, MAX_MEAN_ERROR);
+        within = false;
+    }
+    if (accuracy.settleSeconds < 0 || accuracy.settleSeconds > MAX_SETTLE_SECONDS)
+    {
+        std::printf("    too slow: settles after %.1f s, at most %.1f s allowed\n", accuracy.settleSeconds, MAX_SETTLE_SECONDS);
+        within = false;
+    }
+    return within;
+}
+
+// ON A STOP, PREDICTION HAS TO SEE IT BEFORE BOTH THE OLD CALCULATION AND THE FIXED TIMEOUT,
+// WITHOUT TRACKING THE SPEED BEFORE IT ANY WORSE
+bool stopsFaster(const Accuracy &predicted, const Accuracy &legacy, qint64 stopTimeoutNanos)
+{
+    bool faster = true;
+    const double timeoutSeconds = double(stopTimeoutNanos) / 1000000000;
+    if (predicted.settleSeconds < 0 || predicted.settleSeconds >= timeoutSeconds ||
+        (legacy.settleSeconds >= 0 && predicted.settleSeconds >= legacy.settleSeconds))
+    {
+        std::printf("    stop too slow: seen after %.1f s, legacy %.1f s, timeout %.1f s\n",
+                    predicted.settleSeconds, legacy.settleSeconds, timeoutSeconds);
+        faster = false;
+    }
+    if (predicted.meanError > legacy.meanError)
+    {
+        std::printf("    tracks worse than legacy: mean error %.3f m/s against %.3f m/s\n", predicted.meanError, legacy.meanError);
+        faster = false;
+    }
+    return faster;
+}
+}
+
+bool runEstimatorBenchmarks()
+{
+    const SpeedEstimator::Settings settings;
+
+    Benchmark::section("RUNNING SPEED ESTIMATOR");
+    SpeedEstimator throughput(DISTANCE_PER_REVOLUTION, settings);
+    Benchmark::print(Benchmark::measure("speed estimator addEdge", 5000000, [&](quint64 i) {
+        throughput.addEdge(qint64(i) * 40000000 + qint64(i % 7) * 100000);
+        Benchmark::sink += throughput.speed();
+    }));
+
+    QVector<Profile> profiles;
+    profiles.append(Profile{ "accelerate 1 -> 5 m/s", { Segment{ 5, 1, 1 }, Segment{ 20, 1, 5 }, Segment{ 10, 5, 5 } } });
+    profiles.append(Profile{ "decelerate 5 -> 1 m/s", { Segment{ 5, 5, 5 }, Segment{ 20, 5, 1 }, Segment{ 10, 1, 1 } } });
+    profiles.append(Profile{ "step 2 -> 4 m/s", { Segment{ 10, 2, 2 }, Segment{ 10, 4, 4 } } });
+    profiles.append(Profile{ "step 4 -> 1.5 m/s", { Segment{ 10, 4, 4 }, Segment{ 10, 1.5, 1.5 } } });
+    // LOW SPEED, WHERE EDGES ARE A QUARTER SECOND AND MORE APART
+    profiles.append(Profile{ "accelerate 0.3 -> 2 m/s", { Segment{ 5, 0.3, 0.3 }, Segment{ 10, 0.3, 2 }, Segment{ 5, 2, 2 } } });
+    profiles.append(Profile{ "decelerate 1 -> 0.3 m/s", { Segment{ 5, 1, 1 }, Segment{ 10, 1, 0.3 }, Segment{ 10, 0.3, 0.3 } } });
+    profiles.append(Profile{ "walk 0.5 m/s, stop", { Segment{ 10, 0.5, 0.5 }, Segment{ 10, 0, 0 } } });
+    profiles.append(Profile{ "run 3 m/s, stop", { Segment{ 10, 3, 3 }, Segment{ 10, 0, 0 } } });
+    profiles.append(Profile{ "slow down 2 m/s, stop", { Segment{ 5, 2, 2 }, Segment{ 5, 2, 0.2 }, Segment{ 10, 0, 0 } } });
+
+    Benchmark::section("RUNNING SPEED TRACKING (replayed belt edges, sampled every 100 ms)");
+    SpeedEstimator::Settings holding = settings;
+    holding.stopPeriods = 0;
+    bool accurate = true;
+    for (const Profile &profile : profiles)
+    {
+        SpeedEstimator estimator(DISTANCE_PER_REVOLUTION, settings);
+        const Accuracy predicted = replay(profile, [&](qint64 nanos, bool edge) {
+            if (edge)
+                estimator.addEdge(nanos);
+            estimator.update(nanos);
+            return double(estimator.speed()) / 256;
+        });
+        print(profile, "predicted", predicted);
+        accurate = withinLimits(predicted) && accurate;
+        // THE SAME WINDOW HOLDING ITS SPEED BETWEEN EDGES, AS BEFORE PREDICTION
+        SpeedEstimator window(DISTANCE_PER_REVOLUTION, holding);
+        print(profile, "window", replay(profile, [&](qint64 nanos, bool edge) {
+            if (edge)
+                window.addEdge(nanos);
+            window.update(nanos);
+            return double(window.speed()) / 256;
+        }));
+        LegacyEstimator legacy;
+        const Accuracy old = replay(profile, [&](qint64 nanos, bool edge) {
+            if (edge)
+                legacy.addEdge(nanos);
+            legacy.update(nanos);
+            return legacy.metersPerSecond();
+        });
+        print(profile, "legacy", old);
+        if (profile.segments.last().toMetersPerSecond == 0)
+            accurate = stopsFaster(predicted, old, settings.stopTimeoutNanos) && accurate;
+    }
+    return accurate;
+}
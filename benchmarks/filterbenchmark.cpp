@@ -0,0 +1,188 @@
+#include "benchmark.h"
+#include "edgefilter.h"
+
+#include <cmath>
+#include <cstdio>
+
+namespace
+{
+// FAR SHORTER THAN THE DAEMON'S MILLISECOND POLLING, WHICH IS WHAT THE FILTER IS FOR
+const qint64 SAMPLE_NANOS = 100000;
+const qint64 TRACE_NANOS = 20000000000LL;
+const int PINS = 2;
+// THE SECOND SENSOR TURNS AT THIS FRACTION OF THE FIRST, LIKE A CRANK NEXT TO A WHEEL
+const double SECOND_PIN_RATE = 0.37;
+// MAGNET UNDER THE SENSOR FOR THIS FRACTION OF A REVOLUTION
+const double DUTY = 0.1;
+// AN ELECTRICAL SPIKE LASTS THIS LONG
+const qint64 SPIKE_NANOS = 15000;
+const double RATES_RPM[] = { 60, 600, 3000 };
+const quint64 STEPS = 20000000;
+
+struct Trace
+{
+    const char *name;
+    // BOUNCE AFTER EACH RISE (AND EACH FALL), CHANGING LEVEL AT MOST EVERY bounceStepNanos
+    qint64 bounceNanos;
+    qint64 bounceStepNanos;
+    bool fallBounces;
+    // RANDOM SPIKES PER SECOND
+    double spikesPerSecond;
+};
+
+struct Filter
+{
+    const char *name;
+    EdgeFilter::Settings settings;
+};
+
+quint64 mix(quint64 value)
+{
+    // SPLITMIX64, SO EVERY TRACE IS THE SAME ON EVERY RUN
+    value += 0x9e3779b97f4a7c15ULL;
+    value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    value = (value ^ (value >> 27)) * 0x94d049bb133111ebULL;
+    return value ^ (value >> 31);
+}
+
+// ONE SENSOR: A PULSE EVERY REVOLUTION, CHATTERING FOR bounceNanos AFTER ITS EDGES
+class Sensor
+{
+public:
+    Sensor(int pin, double rpm, const Trace &trace)
+        : pin(pin), period(qint64(60e9 / rpm)), pulse(qint64(double(period) * DUTY)), offset(period / 3), trace(trace)
+    {
+    }
+
+    bool level(qint64 nanos) const
+    {
+        const qint64 position = nanos + offset;
+        const qint64 revolution = position / period;
+        const qint64 phase = position % period;
+        bool high = phase < pulse;
+        const qint64 sinceEdge = high ? phase : phase - pulse;
+        if (sinceEdge >= 0 && sinceEdge < trace.bounceNanos && (high || trace.fallBounces))
+            high = mix(quint64(revolution) * 131 + quint64(sinceEdge / trace.bounceStepNanos) * 7 + quint64(pin) + (high ? 1 : 0)) & 1;
+        const quint64 slot = quint64(nanos / SPIKE_NANOS);
+        const double spikeChance = trace.spikesPerSecond * double(SPIKE_NANOS) / 1e9;
+        if (double(mix(slot * 64 + quint64(pin)) >> 11) / double(1ULL << 53) < spikeChance)
+            high = !high;
+        return high;
+    }
+
+    // REVOLUTIONS THAT START INSIDE THE TRACE
+    quint64 revolutions() const { return quint64((TRACE_NANOS + offset) / period - offset / period); }
+    // HOW FAR A REPORTED RISE IS FROM THE TRUE ONE
+    qint64 riseError(qint64 nanos) const
+    {
+        const qint64 revolution = (nanos + offset + period / 2) / period;
+        return nanos - (revolution * period - offset);
+    }
+
+private:
+    const int pin;
+    const qint64 period;
+    const qint64 pulse;
+    const qint64 offset;
+    const Trace &trace;
+};
+
+struct Outcome
+{
+    quint64 expected = 0;
+    quint64 counted = 0;
+    quint64 glitches = 0;
+    quint64 refractory = 0;
+    double meanRiseErrorMicros = 0;
+};
+
+Outcome replay(const Trace &trace, double rpm, const Filter &filter)
+{
+    const Sensor sensors[PINS] = { Sensor(0, rpm, trace), Sensor(1, rpm * SECOND_PIN_RATE, trace) };
+    EdgeFilter edgeFilter;
+    edgeFilter.configure(filter.settings, SAMPLE_NANOS);
+    edgeFilter.reset(0);
+    Outcome outcome;
+    double errorSum = 0;
+    for (qint64 nanos = 0; nanos < TRACE_NANOS; nanos += SAMPLE_NANOS)
+    {
+        quint64 levels = 0;
+        for (int pin = 0; pin < PINS; ++pin)
+            levels |= quint64(sensors[pin].level(nanos)) << pin;
+        quint64 rising = edgeFilter.step(levels);
+        while (rising)
+        {
+            const int pin = __builtin_ctzll(rising);
+            const qint64 riseNanos = nanos - edgeFilter.riseDelayNanos();
+            if (edgeFilter.accept(pin, riseNanos))
+            {
+                ++outcome.counted;
+                errorSum += std::fabs(double(sensors[pin].riseError(riseNanos)));
+            }
+            rising &= rising - 1;
+        }
+    }
+    for (const Sensor &sensor : sensors)
+        outcome.expected += sensor.revolutions();
+    outcome.glitches = edgeFilter.glitches();
+    outcome.refractory = edgeFilter.refractoryRejects();
+    outcome.meanRiseErrorMicros = outcome.counted ? errorSum / double(outcome.counted) / 1000 : 0;
+    return outcome;
+}
+}
+
+bool runFilterBenchmarks()
+{
+    Benchmark::section("EDGE FILTER (bit-sliced debounce over the 64 pin bank)");
+    EdgeFilter throughput;
+    EdgeFilter::Settings settings;
+    settings.hysteresisSamples = 4;
+    settings.maxRpm = 6000;
+    throughput.configure(settings, SAMPLE_NANOS);
+    throughput.reset(0);
+    Benchmark::print(Benchmark::measure("edge filter step, 64 noisy pins", STEPS, [&](quint64 i) {
+        quint64 rising = throughput.step(mix(i >> 3));
+        Benchmark::sink += rising;
+    }));
+
+    Filter filters[3];
+    filters[0].name = "raw";
+    filters[1].name = "debounce 4";
+    filters[1].settings.hysteresisSamples = 4;
+    filters[2].name = "full";
+    filters[2].settings.hysteresisSamples = 4;
+    filters[2].settings.minPulseMicros = 500;
+    filters[2].settings.maxRpm = 6000;
+    const Trace traces[] = {
+        { "clean", 0, 1, false, 0 },
+        { "bounce 300 us", 300000, 30000, true, 0 },
+        { "bounce + 20 spikes/s", 300000, 30000, true, 20 },
+        { "bounce 600 us + 200 spikes/s", 600000, 30000, true, 200 },
+        // A REED CONTACT BOUNCING ON CLOSING, SLOW ENOUGH TO PASS THE DEBOUNCE AND THE MINIMUM
+        // PULSE: ONLY THE REFRACTORY PERIOD CATCHES IT
+        { "reed closing 1 ms", 1000000, 300000, false, 0 }
+    };
+
+    // THE FULL FILTER MUST COUNT EVERY TRACE EXACTLY, THE OTHERS SHOW WHAT IT SAVES
+    Benchmark::section("EDGE FILTER TRACES (two sensors sampled every 100 us for 20 s, counted against the true revolutions)");
+    bool exact = true;
+    for (const Trace &trace : traces)
+    {
+        for (double rpm : RATES_RPM)
+        {
+            for (const Filter &filter : filters)
+            {
+                const Outcome outcome = replay(trace, rpm, filter);
+                const bool correct = outcome.counted == outcome.expected;
+                std::printf("%-30s %5.0f rpm %-11s %6llu of %6llu edges  %7llu glitches %5llu refractory  rise error %6.1f us%s\n",
+                            trace.name, rpm, filter.name, static_cast<unsigned long long>(outcome.counted),
+                            static_cast<unsigned long long>(outcome.expected), static_cast<unsigned long long>(outcome.glitches),
+                            static_cast<unsigned long long>(outcome.refractory), outcome.meanRiseErrorMicros,
+                            correct ? "" : "  MISCOUNTED");
+                if (&filter == &filters[2] && !correct)
+                    exact = false;
+            }
+        }
+    }
+    return exact;
+}
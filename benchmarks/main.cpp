@@ -0,0 +1,65 @@
+#include "benchmark.h"
+
+#include <QtCore/qcommandlineparser.h>
+#include <QtCore/qcoreapplication.h>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+std::atomic<quint64> allocationCount(0);
+}
+
+// COUNT EVERY HEAP ALLOCATION MADE WHILE A BENCHMARK RUNS
+void *operator new(std::size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void *memory = std::malloc(size ? size : 1))
+        return memory;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void *memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+volatile quint64 Benchmark::sink = 0;
+
+quint64 Benchmark::allocations()
+{
+    return allocationCount.load(std::memory_order_relaxed);
+}
+
+int main(int argc, char *argv[])
+{
+    // THE CAPTURE BENCHMARK NEEDS AN APPLICATION FOR ITS SOCKET NOTIFIER, NOT AN EVENT LOOP
+    QCoreApplication app(argc, argv);
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Benchmarks the hardware independent parts of the sensor daemon. Exits with 1 when the edge to notification pipeline goes over a budget, the running speed estimator tracks a profile too badly, the edge filter miscounts a trace or the event time counter is off.");
+    parser.addHelpOption();
+    parser.addOption(QCommandLineOption("max-nanos-per-edge", "Fail when any profile and rate takes longer per edge.", "ns"));
+    parser.addOption(QCommandLineOption("max-allocations-per-notification", "Fail when any profile and rate allocates more per notification.", "count"));
+    parser.process(app);
+
+    Benchmark::PipelineBudget budget;
+    if (parser.isSet("max-nanos-per-edge"))
+        budget.nanosPerEdge = parser.value("max-nanos-per-edge").toDouble();
+    if (parser.isSet("max-allocations-per-notification"))
+        budget.allocationsPerNotification = parser.value("max-allocations-per-notification").toDouble();
+
+    runEncoderBenchmarks();
+    const bool estimatorAccurate = runEstimatorBenchmarks();
+    runCaptureBenchmarks();
+    runTelemetryBenchmarks();
+    const bool filterExact = runFilterBenchmarks();
+    const bool timebaseExact = runTimebaseBenchmarks();
+    const bool withinBudget = runPipelineBenchmarks(budget);
+    return estimatorAccurate && filterExact && timebaseExact && withinBudget ? 0 : 1;
+}
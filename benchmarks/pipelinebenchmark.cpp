@@ -0,0 +1,133 @@
+#include "benchmark.h"
+#include "cscservice.h"
+#include "ftmsservice.h"
+#include "histogram.h"
+#include "rscservice.h"
+#include "simulatedsensorinput.h"
+
+#include <QtCore/qbytearray.h>
+#include <QtCore/qscopedpointer.h>
+
+namespace
+{
+const quint64 EDGES = 200000;
+const quint64 LATENCY_EDGES = 50000;
+const int WHEEL_PIN = 0;
+const int CRANK_PIN = 1;
+const int BELT_PIN = 2;
+const int DISTANCE_PER_REVOLUTION = 133;
+// FROM A SLOW CRANK TO FAR PAST ANY REAL WHEEL, PER SENSOR
+const double RATES_RPM[] = { 60, 600, 6000, 60000, 600000 };
+
+enum Profile
+{
+    Wheel,
+    Crank,
+    WheelAndCrank,
+    Running,
+    Treadmill
+};
+const char *const PROFILE_NAMES[] = { "csc wheel", "csc crank", "csc wheel+crank", "rsc", "ftms treadmill" };
+
+MeasurementService *createService(Profile profile, SensorInput &clock)
+{
+    switch (profile)
+    {
+    case Wheel:
+        return new CscService(clock, WHEEL_PIN, -1, nullptr);
+    case Crank:
+        return new CscService(clock, -1, CRANK_PIN, nullptr);
+    case WheelAndCrank:
+        return new CscService(clock, WHEEL_PIN, CRANK_PIN, nullptr);
+    case Running:
+        return new RscService(clock, BELT_PIN, DISTANCE_PER_REVOLUTION, SpeedEstimator::Settings(), false, nullptr);
+    case Treadmill:
+        break;
+    }
+    return new FtmsService(clock, BELT_PIN, DISTANCE_PER_REVOLUTION, SpeedEstimator::Settings());
+}
+
+// EDGES OF A SERVICE RUNNING WITHOUT AN ADAPTER: THE SINK STANDS IN FOR THE SUBSCRIBED
+// CENTRAL, THE MANUAL CLOCK FOR THE SENSOR TIMESTAMPS
+class Pipeline
+{
+public:
+    Pipeline(Profile profile, double rpm)
+        : clock(SimulatedSensorInput::ManualClock), service(createService(profile, clock)), pins(service->pins())
+    {
+        // SEVERAL SENSORS TAKE TURNS, EACH AT THE FULL RATE
+        step = qint64(60e9 / rpm) / pins.size();
+        service->setSink([this](const QByteArray &value) {
+            ++notifications;
+            Benchmark::sink += quint64(value.constData()[0]);
+        });
+        // NO COALESCING, SO EVERY EDGE GOES ALL THE WAY TO A NOTIFICATION
+        NotificationScheduler::Settings scheduling;
+        scheduling.coalesceWindowMillis = 0;
+        service->startReporting(scheduling);
+    }
+
+    void edge(quint64 i)
+    {
+        clock.advance(step);
+        service->handleEdge(pins.at(int(i % quint64(pins.size()))), clock.now());
+    }
+
+    quint64 notifications = 0;
+
+private:
+    SimulatedSensorInput clock;
+    QScopedPointer<MeasurementService> service;
+    const QList<int> pins;
+    qint64 step;
+};
+
+bool run(Profile profile, double rpm, const Benchmark::PipelineBudget &budget)
+{
+    Pipeline pipeline(profile, rpm);
+    const Benchmark::Result result = Benchmark::measure(PROFILE_NAMES[profile], EDGES, [&](quint64 i) { pipeline.edge(i); });
+    const double allocationsPerNotification =
+        pipeline.notifications ? result.allocationsPerOperation * double(EDGES) / double(pipeline.notifications) : 0;
+
+    // A SECOND, SHORTER PASS WITH A CLOCK READ AROUND EVERY EDGE
+    Histogram latency;
+    for (quint64 i = 0; i < LATENCY_EDGES; ++i)
+    {
+        const qint64 started = SensorInput::monotonicNanos();
+        pipeline.edge(EDGES + i);
+        latency.record(SensorInput::monotonicNanos() - started);
+    }
+
+    std::printf("%-16s %7.0f rpm %11.0f edges/s %8.1f ns/edge  p50 %6llu  p99 %6llu  max %8llu ns %6.2f allocs/notification\n",
+                result.name, rpm, 1e9 / result.nanosPerOperation, result.nanosPerOperation,
+                static_cast<unsigned long long>(latency.quantileNanos(0.5)),
+                static_cast<unsigned long long>(latency.quantileNanos(0.99)),
+                static_cast<unsigned long long>(latency.maxNanos()), allocationsPerNotification);
+
+    bool withinBudget = true;
+    if (budget.nanosPerEdge >= 0 && result.nanosPerOperation > budget.nanosPerEdge)
+    {
+        std::printf("    over budget: %.1f ns/edge, at most %.1f allowed\n", result.nanosPerOperation, budget.nanosPerEdge);
+        withinBudget = false;
+    }
+    if (budget.allocationsPerNotification >= 0 && allocationsPerNotification > budget.allocationsPerNotification)
+    {
+        std::printf("    over budget: %.2f allocs/notification, at most %.2f allowed\n", allocationsPerNotification,
+                    budget.allocationsPerNotification);
+        withinBudget = false;
+    }
+    return withinBudget;
+}
+}
+
+bool runPipelineBenchmarks(const Benchmark::PipelineBudget &budget)
+{
+    Benchmark::section("EDGE TO NOTIFICATION (service, scheduler, encoder, mock sink)");
+    bool withinBudget = true;
+    for (Profile profile : { Wheel, Crank, WheelAndCrank, Running, Treadmill })
+    {
+        for (double rpm : RATES_RPM)
+            withinBudget = run(profile, rpm, budget) && withinBudget;
+    }
+    return withinBudget;
+}
@@ -0,0 +1,117 @@
+#include "benchmark.h"
+#include "telemetrypublisher.h"
+#include "telemetryreader.h"
+
+#include <QtCore/qbytearray.h>
+#include <QtCore/qstring.h>
+#include <atomic>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace
+{
+const quint64 UPDATES = 5000000;
+const quint64 READS = 5000000;
+const int READER_COUNTS[] = { 0, 1, 4 };
+
+// THE WRITER KEEPS THE WHEEL AND CRANK COUNTS EQUAL, SO A COPY WHERE THEY DIFFER IS TORN
+Telemetry::Values update(quint64 i)
+{
+    Telemetry::Values values;
+    values.updatedNanos = qint64(i);
+    values.wheelRevolutions = quint32(i);
+    values.crankRevolutions = quint32(i);
+    values.lastWheelEdgeNanos = qint64(i);
+    values.lastCrankEdgeNanos = qint64(i);
+    values.lastWheelEventTime = quint16(i);
+    values.lastCrankEventTime = quint16(i);
+    values.speed = quint16(i);
+    values.cadence = quint16(i);
+    values.wheelRpm = quint32(i);
+    values.totalDistance = quint32(i);
+    return values;
+}
+
+bool consistent(const Telemetry::Values &values)
+{
+    return values.wheelRevolutions == values.crankRevolutions && quint32(values.updatedNanos) == values.totalDistance
+           && quint16(values.wheelRpm) == values.speed;
+}
+
+// READERS POLLING IN A LOOP, AS HARD AS A DASHBOARD EVER COULD, WHILE THE DAEMON PUBLISHES
+class Readers
+{
+public:
+    Readers(const QByteArray &name, int count)
+    {
+        for (int i = 0; i < count; ++i)
+        {
+            threads.emplace_back([this, name]() {
+                TelemetryReader reader;
+                if (!reader.open(name.constData()))
+                    return;
+                Telemetry::Values values;
+                while (!stopping.load(std::memory_order_relaxed))
+                {
+                    if (!reader.read(0, &values))
+                        continue;
+                    reads.fetch_add(1, std::memory_order_relaxed);
+                    if (!consistent(values))
+                        torn.fetch_add(1, std::memory_order_relaxed);
+                }
+            });
+        }
+    }
+    ~Readers()
+    {
+        stopping = true;
+        for (std::thread &thread : threads)
+            thread.join();
+    }
+
+    std::atomic<quint64> reads{0};
+    std::atomic<quint64> torn{0};
+
+private:
+    std::atomic<bool> stopping{false};
+    std::vector<std::thread> threads;
+};
+}
+
+void runTelemetryBenchmarks()
+{
+    Benchmark::section("SHARED-MEMORY TELEMETRY (seqlock, one station)");
+    const QString name = QStringLiteral("/bluetooth-benchmark-") + QString::number(getpid());
+    TelemetryPublisher publisher(name);
+    if (!publisher.open(1))
+        return;
+    publisher.setStation(0, Telemetry::Running, QStringLiteral("rsc"));
+
+    for (int readerCount : READER_COUNTS)
+    {
+        quint64 reads = 0;
+        quint64 torn = 0;
+        char label[64];
+        std::snprintf(label, sizeof(label), "publish, %d polling reader%s", readerCount, readerCount == 1 ? "" : "s");
+        Benchmark::Result result;
+        {
+            Readers readers(name.toLocal8Bit(), readerCount);
+            result = Benchmark::measure(label, UPDATES, [&](quint64 i) { publisher.publish(0, update(i)); });
+            reads = readers.reads.load();
+            torn = readers.torn.load();
+        }
+        Benchmark::print(result);
+        if (readerCount)
+            std::printf("    %llu reads, %llu torn\n", static_cast<unsigned long long>(reads), static_cast<unsigned long long>(torn));
+    }
+
+    TelemetryReader reader;
+    if (!reader.open(name.toLocal8Bit().constData()))
+        return;
+    Telemetry::Values values;
+    Benchmark::print(Benchmark::measure("read, writer idle", READS, [&](quint64) {
+        reader.read(0, &values);
+        Benchmark::sink += values.wheelRevolutions;
+    }));
+}
@@ -0,0 +1,97 @@
+#include "benchmark.h"
+#include "measurementencoder.h"
+#include "simulatedsensorinput.h"
+#include "timebase.h"
+
+#include <time.h>
+
+namespace
+{
+const quint64 OPERATIONS = 20000000;
+const quint64 CLOCK_READS = 5000000;
+const quint64 FAKE_SAMPLES = 20000000;
+
+qint64 clockNanos(clockid_t clock)
+{
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return qint64(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+// THE FAKE CLOCK OF THE CHECK, MOVED BY THE CHECK ITSELF
+qint64 fakeNanos = 0;
+
+qint64 fakeNow()
+{
+    return fakeNanos;
+}
+
+quint64 mix(quint64 value)
+{
+    // SPLITMIX64, SO EVERY RUN STEPS THE FAKE CLOCK THE SAME WAY
+    value += 0x9e3779b97f4a7c15ULL;
+    value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    value = (value ^ (value >> 27)) * 0x94d049bb133111ebULL;
+    return value ^ (value >> 31);
+}
+
+// MOSTLY EDGE PERIODS, NOW AND THEN A STOP, A PAUSE PAST THE 64 S WRAP OR A STEP BACK
+qint64 step(quint64 i)
+{
+    const quint64 random = mix(i);
+    switch (random % 1000)
+    {
+    case 0:
+        return qint64(random >> 20) % 200000000000LL;
+    case 1:
+        return -qint64(random >> 40);
+    case 2:
+        return 1 << 30;
+    default:
+        return 100000 + qint64(random >> 44) % 2000000;
+    }
+}
+}
+
+bool runTimebaseBenchmarks()
+{
+    Benchmark::section("TIMEBASE (sensor clock read once per sample, event times carried between edges)");
+    Benchmark::print(Benchmark::measure("clock read CLOCK_MONOTONIC", CLOCK_READS, [](quint64) {
+        Benchmark::sink += quint64(clockNanos(CLOCK_MONOTONIC));
+    }));
+    Benchmark::print(Benchmark::measure("clock read Timebase (CLOCK_MONOTONIC_RAW)", CLOCK_READS, [](quint64) {
+        Benchmark::sink += quint64(Timebase::now());
+    }));
+
+    // EDGES 0.1 TO 2.1 MS APART, AS FROM A FAST WHEEL
+    Benchmark::print(Benchmark::measure("event time 64 bit division", OPERATIONS, [](quint64 i) {
+        Benchmark::sink += MeasurementEncoding::eventTime(qint64(i) * 1100000 + qint64(mix(i) >> 44));
+    }));
+    Timebase::EventTimeCounter counter;
+    Benchmark::print(Benchmark::measure("event time counter", OPERATIONS, [&](quint64 i) {
+        Benchmark::sink += counter.at(qint64(i) * 1100000 + qint64(mix(i) >> 44));
+    }));
+
+    // THE TEST HOOK: THE FAKE CLOCK DRIVES THE SIMULATED INPUT, AND THE COUNTER MUST GIVE THE
+    // EXACT EVENT TIME OF EVERY SAMPLE WHEREVER THE CLOCK JUMPS
+    Timebase::setSource(&fakeNow);
+    fakeNanos = 123456789;
+    SimulatedSensorInput input(SimulatedSensorInput::RealTimeClock);
+    Timebase::EventTimeCounter checked;
+    quint64 mismatches = 0;
+    bool followsFake = true;
+    for (quint64 i = 0; i < FAKE_SAMPLES; ++i)
+    {
+        fakeNanos = qMax<qint64>(0, fakeNanos + step(i));
+        const qint64 now = Timebase::now();
+        if (checked.at(now) != MeasurementEncoding::eventTime(now))
+            ++mismatches;
+        if (i % 4096 == 0 && input.now() != fakeNanos - 123456789)
+            followsFake = false;
+    }
+    Timebase::setSource(nullptr);
+    std::printf("fake clock: %llu samples, %llu event time mismatches, simulated input %s the fake clock\n",
+                static_cast<unsigned long long>(FAKE_SAMPLES), static_cast<unsigned long long>(mismatches),
+                followsFake ? "follows" : "DOES NOT FOLLOW");
+    return mismatches == 0 && followsFake;
+}
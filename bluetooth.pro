@@ -0,0 +1,11 @@
+TEMPLATE = subdirs
+
+SUBDIRS += sensor-daemon \
+           benchmarks \
+           csc-speed-service \
+           csc-cadence-service \
+           csc-speed-cadence-service \
+           running-speed-service \
+           session-export \
+           session-analyzer \
+           telemetry-monitor
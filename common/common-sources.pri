@@ -0,0 +1,48 @@
+# THE HARDWARE INDEPENDENT PART OF common/: THE SERVICES, THE SENSOR INPUT WITH ONLY ITS
+# SIMULATED BACKEND, CAPTURE BY POLLING, RECORDING AND TELEMETRY.  BUILDS ANYWHERE WITH THE
+# BLUETOOTH MODULE BUT NEEDS NO ADAPTER.  common.pri ADDS THE PERIPHERAL, THE DAEMON AND GPIO
+INCLUDEPATH += $$PWD
+DEPENDPATH += $$PWD
+
+HEADERS += $$PWD/cscservice.h \
+           $$PWD/edgecapture.h \
+           $$PWD/edgefilter.h \
+           $$PWD/ftmsservice.h \
+           $$PWD/histogram.h \
+           $$PWD/measurementencoder.h \
+           $$PWD/measurementservice.h \
+           $$PWD/notificationscheduler.h \
+           $$PWD/persistentcounters.h \
+           $$PWD/rscservice.h \
+           $$PWD/sensorinput.h \
+           $$PWD/sessionlog.h \
+           $$PWD/sessionreader.h \
+           $$PWD/sessionrecorder.h \
+           $$PWD/simulatedsensorinput.h \
+           $$PWD/speedestimator.h \
+           $$PWD/spscring.h \
+           $$PWD/telemetrylayout.h \
+           $$PWD/telemetrypublisher.h \
+           $$PWD/telemetryreader.h \
+           $$PWD/timebase.h
+
+SOURCES += $$PWD/cscservice.cpp \
+           $$PWD/edgecapture.cpp \
+           $$PWD/edgefilter.cpp \
+           $$PWD/ftmsservice.cpp \
+           $$PWD/histogram.cpp \
+           $$PWD/measurementservice.cpp \
+           $$PWD/notificationscheduler.cpp \
+           $$PWD/persistentcounters.cpp \
+           $$PWD/rscservice.cpp \
+           $$PWD/sensorinput.cpp \
+           $$PWD/sessionreader.cpp \
+           $$PWD/sessionrecorder.cpp \
+           $$PWD/simulatedsensorinput.cpp \
+           $$PWD/speedestimator.cpp \
+           $$PWD/telemetrypublisher.cpp \
+           $$PWD/telemetryreader.cpp \
+           $$PWD/timebase.cpp
+
+# shm_open LIVES IN librt BEFORE GLIBC 2.34
+LIBS += -lrt
@@ -0,0 +1,20 @@
+include($$PWD/common-sources.pri)
+
+HEADERS += $$PWD/peripheral.h \
+           $$PWD/sensordaemon.h
+
+SOURCES += $$PWD/peripheral.cpp \
+           $$PWD/sensordaemon.cpp
+
+# WITHOUT WIRING PI (E.G. ON AN X86 BUILD MACHINE) ONLY THE SIMULATED SENSOR INPUT IS AVAILABLE
+exists(/usr/include/wiringPi.h)|exists(/usr/local/include/wiringPi.h) {
+    DEFINES += HAVE_WIRINGPI
+    LIBS += -lwiringPi
+}
+
+# KERNEL GPIO EDGE EVENTS NEED THE libgpiod 1.x API, OTHERWISE ONLY POLLING IS BUILT
+CONFIG += link_pkgconfig
+packagesExist(libgpiod) {
+    DEFINES += HAVE_LIBGPIOD
+    PKGCONFIG += libgpiod
+}
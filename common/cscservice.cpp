@@ -0,0 +1,145 @@
+#include "cscservice.h"
+#include "persistentcounters.h"
+#include "sensorinput.h"
+
+#include <QtBluetooth/qlowenergycharacteristic.h>
+#include <QtBluetooth/qlowenergycharacteristicdata.h>
+#include <QtBluetooth/qlowenergydescriptordata.h>
+
+namespace
+{
+int (*encoderFor(bool wheel, bool crank))(const CscMeasurement &, char *)
+{
+    if (wheel && crank)
+        return &CscMeasurementEncoder<CscMeasurement::WheelRevolutionDataPresent | CscMeasurement::CrankRevolutionDataPresent>::encode;
+    if (crank)
+        return &CscMeasurementEncoder<CscMeasurement::CrankRevolutionDataPresent>::encode;
+    return &CscMeasurementEncoder<CscMeasurement::WheelRevolutionDataPresent>::encode;
+}
+
+// NO EDGE FOR THIS LONG MEANS STOPPED, AS FOR THE RUNNING SPEED
+const qint64 STOP_TIMEOUT_NANOS = 2000000000;
+
+// 1/100 RPM FROM THE LAST EDGE PERIOD, SLOWING DOWN ONCE THE NEXT EDGE IS LATE
+quint32 hundredthRpm(qint64 previousEdge, qint64 lastEdge, qint64 now)
+{
+    if (previousEdge < 0 || now - lastEdge > STOP_TIMEOUT_NANOS)
+        return 0;
+    const qint64 period = qMax(lastEdge - previousEdge, now - lastEdge);
+    return period > 0 ? quint32(Q_INT64_C(6000000000000) / period) : 0;
+}
+}
+
+CscService::CscService(SensorInput &clock, int wheelPin, int crankPin, PersistentCounters *counters)
+    : MeasurementService(clock, QBluetoothUuid::CyclingSpeedAndCadence, QBluetoothUuid::CSCMeasurement),
+      wheelPin(wheelPin), crankPin(crankPin), encoder(encoderFor(wheelPin >= 0, crankPin >= 0)), counters(counters)
+{
+    measurement.cumulativeWheelRevolutions = 0;
+    measurement.lastWheelEventTime = 0;
+    measurement.cumulativeCrankRevolutions = 0;
+    measurement.lastCrankEventTime = 0;
+    if (counters)
+        restoreCounters(counters->values());
+
+    // SET UP CHARACTERISTIC DATA FOR SPEED MEASUREMENT
+    QLowEnergyCharacteristicData cscMeasurementData;
+    cscMeasurementData.setUuid(QBluetoothUuid::CSCMeasurement);
+    cscMeasurementData.setValue(QByteArray(2, 0));
+    cscMeasurementData.setProperties(QLowEnergyCharacteristic::Notify);
+    const QLowEnergyDescriptorData clientConfig(QBluetoothUuid::ClientCharacteristicConfiguration,
+                                                QByteArray(2, 0));
+    cscMeasurementData.addDescriptor(clientConfig);
+
+    // SET UP CHARACTERISTIC DATA FOR WEEL REVOLUTION DATA
+    QLowEnergyCharacteristicData cscDescriptionData;
+    cscDescriptionData.setUuid(QBluetoothUuid::CSCFeature);
+    // uint16 bit field: bit 0 "Wheel Revolution Data Supported", bit 1 "Crank Revolution Data Supported"
+    QByteArray cscDescriptionBytes(2, 0);
+    MeasurementEncoding::putUInt16(cscDescriptionBytes.data(),
+                                   (wheelPin >= 0 ? CscMeasurement::WheelRevolutionDataSupported : 0)
+                                       | (crankPin >= 0 ? CscMeasurement::CrankRevolutionDataSupported : 0));
+    cscDescriptionData.setValue(cscDescriptionBytes);
+    cscDescriptionData.setProperties(QLowEnergyCharacteristic::Read);
+
+    // SET UP SENSOR LOCATION.  USE RIGHT CRANK FOR IT
+    QLowEnergyCharacteristicData cscLocationData;
+    cscLocationData.setUuid(QBluetoothUuid::SensorLocation);
+    QByteArray cscLocationBytes;
+    cscLocationBytes.append(char(6));
+    cscLocationData.setValue(cscLocationBytes);
+    cscLocationData.setProperties(QLowEnergyCharacteristic::Read);
+
+    // NOW COLLECT ALL CHARACTERISTICS AND ATTACH TO SERVICE
+    serviceData.addCharacteristic(cscMeasurementData);
+    serviceData.addCharacteristic(cscDescriptionData);
+    serviceData.addCharacteristic(cscLocationData);
+}
+
+void CscService::restoreCounters(const quint32 *values)
+{
+    measurement.cumulativeWheelRevolutions = values[PersistentCounters::WheelRevolutions];
+    measurement.lastWheelEventTime = quint16(values[PersistentCounters::LastWheelEventTime]);
+    measurement.cumulativeCrankRevolutions = quint16(values[PersistentCounters::CrankRevolutions]);
+    measurement.lastCrankEventTime = quint16(values[PersistentCounters::LastCrankEventTime]);
+}
+
+QList<int> CscService::pins() const
+{
+    QList<int> result;
+    if (wheelPin >= 0)
+        result << wheelPin;
+    if (crankPin >= 0)
+        result << crankPin;
+    return result;
+}
+
+void CscService::handleEdge(int pin, qint64 timestampNanos)
+{
+    // THE CUMULATIVE COUNTS AND EVENT TIMES WRAP AT THEIR FIELD WIDTHS, WHICH CLIENTS EXPECT
+    if (pin == wheelPin)
+    {
+        measurement.cumulativeWheelRevolutions += 1;
+        measurement.lastWheelEventTime = wheelEventTime.at(timestampNanos);
+        previousWheelEdge = lastWheelEdge;
+        lastWheelEdge = timestampNanos;
+    }
+    if (pin == crankPin)
+    {
+        measurement.cumulativeCrankRevolutions += 1;
+        measurement.lastCrankEventTime = crankEventTime.at(timestampNanos);
+        previousCrankEdge = lastCrankEdge;
+        lastCrankEdge = timestampNanos;
+    }
+    if (counters)
+    {
+        counters->set(PersistentCounters::WheelRevolutions, measurement.cumulativeWheelRevolutions);
+        counters->set(PersistentCounters::LastWheelEventTime, measurement.lastWheelEventTime);
+        counters->set(PersistentCounters::CrankRevolutions, measurement.cumulativeCrankRevolutions);
+        counters->set(PersistentCounters::LastCrankEventTime, measurement.lastCrankEventTime);
+        counters->commit();
+    }
+    measurementChanged(timestampNanos);
+}
+
+void CscService::report()
+{
+    if (publishesTelemetry())
+    {
+        // THERE IS NO WHEEL CIRCUMFERENCE HERE, SO READERS GET WHEEL RPM RATHER THAN SPEED
+        const qint64 now = clock.now();
+        Telemetry::Values values;
+        values.updatedNanos = now;
+        values.wheelRevolutions = measurement.cumulativeWheelRevolutions;
+        values.crankRevolutions = measurement.cumulativeCrankRevolutions;
+        values.lastWheelEdgeNanos = lastWheelEdge;
+        values.lastCrankEdgeNanos = lastCrankEdge;
+        values.lastWheelEventTime = measurement.lastWheelEventTime;
+        values.lastCrankEventTime = measurement.lastCrankEventTime;
+        values.speed = 0;
+        values.cadence = quint16(hundredthRpm(previousCrankEdge, lastCrankEdge, now) / 100);
+        values.wheelRpm = hundredthRpm(previousWheelEdge, lastWheelEdge, now);
+        values.totalDistance = 0;
+        publishTelemetry(values);
+    }
+    sendMeasurement(packet, encoder(measurement, packet));
+}
@@ -0,0 +1,46 @@
+#ifndef CSCSERVICE_H
+#define CSCSERVICE_H
+
+#include "measurementencoder.h"
+#include "measurementservice.h"
+#include "timebase.h"
+
+class PersistentCounters;
+
+// CYCLING SPEED AND CADENCE: WHEEL REVOLUTIONS, CRANK REVOLUTIONS OR BOTH
+class CscService : public MeasurementService
+{
+public:
+    // A PIN OF -1 LEAVES THAT HALF OF THE MEASUREMENT OUT.  WITH PERSISTENT COUNTERS THE
+    // CUMULATIVE COUNTS AND EVENT TIMES CARRY ON FROM THE LAST RUN
+    CscService(SensorInput &clock, int wheelPin, int crankPin, PersistentCounters *counters);
+
+    const char *name() const override { return "csc"; }
+    QList<int> pins() const override;
+    void handleEdge(int pin, qint64 timestampNanos) override;
+    void restoreCounters(const quint32 *values) override;
+
+protected:
+    void report() override;
+
+private:
+    typedef int (*Encoder)(const CscMeasurement &measurement, char *out);
+
+    const int wheelPin;
+    const int crankPin;
+    // PICKED ONCE FROM THE SENSORS PRESENT, SO EACH REPORT RUNS A SPECIALIZED ENCODER
+    const Encoder encoder;
+    PersistentCounters *const counters;
+    CscMeasurement measurement;
+    // EACH SENSOR'S EDGES COME IN ORDER, SO ITS EVENT TIME CARRIES ON FROM THE PREVIOUS EDGE
+    Timebase::EventTimeCounter wheelEventTime;
+    Timebase::EventTimeCounter crankEventTime;
+    // MONOTONIC TIMES OF THE LAST TWO EDGES OF EACH SENSOR FOR THE TELEMETRY RPM, -1 UNTIL SEEN
+    qint64 lastWheelEdge = -1;
+    qint64 previousWheelEdge = -1;
+    qint64 lastCrankEdge = -1;
+    qint64 previousCrankEdge = -1;
+    char packet[MAX_MEASUREMENT_SIZE];
+};
+
+#endif // CSCSERVICE_H
@@ -0,0 +1,501 @@
+#include "edgecapture.h"
+#include "sensorinput.h"
+#include "timebase.h"
+
+#include <QtCore/qloggingcategory.h>
+#include <QtCore/qsocketnotifier.h>
+#include <cstring>
+#include <errno.h>
+#include <initializer_list>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef HAVE_LIBGPIOD
+#include <gpiod.h>
+#endif
+
+namespace
+{
+const char *const GPIO_CHIP_NAME = "gpiochip0";
+const char *const GPIO_CONSUMER = "bluetooth-sensor";
+// STACK THE CAPTURE THREAD TOUCHES UP FRONT SO IT NEVER PAGE FAULTS LATER
+const int PREFAULT_STACK_SIZE = 64 * 1024;
+
+qint64 clockNanos(clockid_t clock)
+{
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return qint64(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+// ONLY THE CAPTURE THREAD WRITES THESE, SO A RELAXED LOAD AND STORE IS ENOUGH
+template <typename T>
+void add(std::atomic<T> &counter, T value)
+{
+    counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+// THE QT THREAD TAKES THE MAXIMA WITH exchange(0) AT EVERY REPORT, SO RAISING ONE MUST NOT
+// OVERWRITE A RESET IT DID NOT SEE
+template <typename T>
+void raise(std::atomic<T> &maximum, T value)
+{
+    T current = maximum.load(std::memory_order_relaxed);
+    while (value > current && !maximum.compare_exchange_weak(current, value, std::memory_order_relaxed))
+        ;
+}
+}
+
+EdgeCapture::EdgeCapture(SensorInput &input, Mode mode, qint64 pollingIntervalNanos)
+    : input(input), currentMode(mode), pollingInterval(pollingIntervalNanos)
+{
+    QObject::connect(&statsTimer, &QTimer::timeout, [this]() { reportStats(); });
+}
+
+EdgeCapture::~EdgeCapture()
+{
+    stop();
+    closeEdgeEvents();
+}
+
+bool EdgeCapture::addPin(int pin)
+{
+    if (pin < 0 || pin >= MAX_PINS)
+    {
+        qWarning() << "cannot capture pin" << pin << "- pins must be 0 to" << MAX_PINS - 1;
+        return false;
+    }
+    Pin entry;
+    entry.pin = pin;
+    entry.line = nullptr;
+    pins.append(entry);
+    pinMask |= quint64(1) << pin;
+    return true;
+}
+
+bool EdgeCapture::start(const EdgeHandler &edgeHandler)
+{
+    handler = edgeHandler;
+    if (currentMode == EdgeEventMode && !openEdgeEvents())
+    {
+        qWarning() << "GPIO edge events unavailable, falling back to polling every" << pollingInterval / 1e6 << "ms";
+        currentMode = PollingMode;
+    }
+    filter.configure(filterSettings, pollingInterval);
+    filter.reset(0);
+    if (currentMode == PollingMode)
+    {
+        for (const Pin &pin : pins)
+            input.configurePin(pin.pin);
+        filter.reset(input.readBank(pinMask));
+    }
+
+    wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    stopFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    listenFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wakeFd < 0 || stopFd < 0 || listenFd < 0)
+    {
+        qWarning() << "cannot create capture eventfd:" << strerror(errno);
+        closeEventFds();
+        return false;
+    }
+    wakeNotifier = new QSocketNotifier(wakeFd, QSocketNotifier::Read);
+    QObject::connect(wakeNotifier, &QSocketNotifier::activated, [this]() {
+        quint64 count;
+        if (::read(wakeFd, &count, sizeof(count)) == sizeof(count))
+            drain();
+    });
+
+    lastReportNanos = SensorInput::monotonicNanos();
+    lastReportCpuNanos = clockNanos(CLOCK_PROCESS_CPUTIME_ID);
+    lastPollNanos = input.now();
+    lastEdgeNanos = lastPollNanos;
+    // LOCKING IS PROCESS WIDE, SO IT HAPPENS HERE RATHER THAN ON THE CAPTURE THREAD
+    if (realTime.enabled && mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+        qWarning() << "real-time capture: memory not locked (needs CAP_IPC_LOCK or a larger RLIMIT_MEMLOCK):" << strerror(errno);
+    running = true;
+    thread = std::thread([this]() {
+        if (realTime.enabled)
+            enterRealTime();
+        if (currentMode == EdgeEventMode)
+            edgeEventLoop();
+        else
+            pollingLoop();
+    });
+    return true;
+}
+
+void EdgeCapture::stop()
+{
+    if (!running.exchange(false))
+        return;
+    const quint64 one = 1;
+    if (::write(stopFd, &one, sizeof(one)) != sizeof(one))
+        qWarning() << "cannot signal the capture thread to stop";
+    thread.join();
+    delete wakeNotifier;
+    wakeNotifier = nullptr;
+    closeEventFds();
+}
+
+void EdgeCapture::closeEventFds()
+{
+    for (int *fd : { &wakeFd, &stopFd, &listenFd })
+    {
+        if (*fd >= 0)
+            close(*fd);
+        *fd = -1;
+    }
+}
+
+void EdgeCapture::setListening(bool value)
+{
+    if (listening.exchange(value, std::memory_order_relaxed) == value || !value || listenFd < 0)
+        return;
+    const quint64 one = 1;
+    if (::write(listenFd, &one, sizeof(one)) != sizeof(one))
+        qWarning() << "cannot wake the idle capture thread";
+}
+
+int EdgeCapture::drain()
+{
+    Edge batch[DRAIN_BATCH];
+    int total = 0;
+    int count;
+    const qint64 timestamp = input.now();
+    while ((count = ring.pop(batch, DRAIN_BATCH)) > 0)
+    {
+        for (int i = 0; i < count; ++i)
+        {
+            const qint64 latency = timestamp - batch[i].timestampNanos;
+            drainLatencySum += latency;
+            drainLatencyMax = qMax(drainLatencyMax, latency);
+            handler(batch[i].pin, batch[i].timestampNanos);
+        }
+        total += count;
+    }
+    drainedCount += quint64(total);
+    return total;
+}
+
+EdgeCapture::Stats EdgeCapture::stats() const
+{
+    Stats current;
+    current.edges = edgeCount.load(std::memory_order_relaxed);
+    current.wakeups = wakeupCount.load(std::memory_order_relaxed);
+    current.timestampErrorSumNanos = timestampErrorSum.load(std::memory_order_relaxed);
+    current.timestampErrorMaxNanos = timestampErrorMax.load(std::memory_order_relaxed);
+    current.overflows = ring.overflows();
+    current.ringHighWater = ring.highWaterMark();
+    current.drained = drainedCount;
+    current.drainLatencySumNanos = drainLatencySum;
+    current.drainLatencyMaxNanos = drainLatencyMax;
+    current.wakeLatenessSumNanos = wakeLatenessSum.load(std::memory_order_relaxed);
+    current.wakeLatenessMaxNanos = wakeLatenessMax.load(std::memory_order_relaxed);
+    current.idleWakeups = idleWakeupCount.load(std::memory_order_relaxed);
+    current.glitches = glitchCount.load(std::memory_order_relaxed);
+    current.refractoryRejects = refractoryCount.load(std::memory_order_relaxed);
+    return current;
+}
+
+void EdgeCapture::startStatsReporting(int intervalMillis)
+{
+    statsTimer.start(intervalMillis);
+}
+
+void EdgeCapture::poll()
+{
+    const qint64 timestamp = input.now();
+    // THE EDGE HAPPENED SOMEWHERE SINCE THE PREVIOUS SAMPLE, SO WE ARE OFF BY HALF THAT WINDOW ON AVERAGE
+    const qint64 error = (timestamp - lastPollNanos) / 2;
+    lastPollNanos = timestamp;
+    add<quint64>(wakeupCount, 1);
+    quint64 rising = filter.step(input.readBank(pinMask));
+    glitchCount.store(filter.glitches(), std::memory_order_relaxed);
+    if (!rising)
+        return;
+    lastEdgeNanos = timestamp;
+    // THE FILTER REPORTS A RISE ONLY ONCE IT HELD, BUT IT STARTED THAT MANY SAMPLES EARLIER
+    const qint64 riseNanos = timestamp - filter.riseDelayNanos();
+    // ONE ITERATION PER EDGE, NOT PER PIN
+    while (rising)
+    {
+        const int pin = __builtin_ctzll(rising);
+        if (filter.accept(pin, riseNanos))
+            recordEdge(pin, riseNanos, error);
+        rising &= rising - 1;
+    }
+    refractoryCount.store(filter.refractoryRejects(), std::memory_order_relaxed);
+}
+
+QCommandLineOption EdgeCapture::modeOption()
+{
+    return QCommandLineOption("capture", "Hall sensor capture mode: edge (kernel GPIO events) or poll.", "mode", "edge");
+}
+
+EdgeCapture::Mode EdgeCapture::modeFromString(const QString &value)
+{
+    return value == QLatin1String("poll") ? PollingMode : EdgeEventMode;
+}
+
+bool EdgeCapture::openEdgeEvents()
+{
+#ifdef HAVE_LIBGPIOD
+    if (pins.isEmpty() || input.lineOffset(pins.first().pin) < 0)
+        return false;
+    chip = gpiod_chip_open_by_name(GPIO_CHIP_NAME);
+    if (!chip)
+        return false;
+    for (Pin &pin : pins)
+    {
+        const int offset = input.lineOffset(pin.pin);
+        pin.line = offset < 0 ? nullptr : gpiod_chip_get_line(chip, unsigned(offset));
+        if (!pin.line || gpiod_line_request_rising_edge_events(pin.line, GPIO_CONSUMER) < 0)
+        {
+            pin.line = nullptr;
+            closeEdgeEvents();
+            return false;
+        }
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+void EdgeCapture::closeEdgeEvents()
+{
+#ifdef HAVE_LIBGPIOD
+    for (Pin &pin : pins)
+    {
+        if (pin.line)
+            gpiod_line_release(pin.line);
+        pin.line = nullptr;
+    }
+    if (chip)
+        gpiod_chip_close(chip);
+    chip = nullptr;
+#endif
+}
+
+void EdgeCapture::enterRealTime()
+{
+    // RUNS ON THE CAPTURE THREAD BEFORE ITS LOOP, THE ONLY PLACE IT MAY STILL ALLOCATE (LOGGING)
+    if (realTime.cpu >= 0)
+    {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(realTime.cpu, &cpus);
+        const int error = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+        if (error != 0)
+            qWarning() << "real-time capture: cannot pin to cpu" << realTime.cpu << strerror(error);
+    }
+    struct sched_param parameters;
+    memset(&parameters, 0, sizeof(parameters));
+    parameters.sched_priority = realTime.priority;
+    const int error = pthread_setschedparam(pthread_self(), SCHED_FIFO, &parameters);
+    if (error != 0)
+        qWarning() << "real-time capture: keeping the normal scheduler (SCHED_FIFO needs CAP_SYS_NICE or RLIMIT_RTPRIO):" << strerror(error);
+    else
+        realTimeRunning.store(true, std::memory_order_relaxed);
+    char stack[PREFAULT_STACK_SIZE];
+    volatile char *touch = stack;
+    for (int i = 0; i < PREFAULT_STACK_SIZE; i += 1024)
+        touch[i] = 0;
+}
+
+void EdgeCapture::pollingLoop()
+{
+    struct pollfd stop = { stopFd, POLLIN, 0 };
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    while (running.load(std::memory_order_relaxed))
+    {
+        poll();
+        if (pendingWake)
+            wakeConsumer();
+        if (idling())
+        {
+            if (!coarseFilter)
+            {
+                coarseFilter = true;
+                filter.setCoarse(true);
+            }
+            if (!idleWait())
+                break;
+            // THE FULL RATE STARTS OVER FROM NOW RATHER THAN CATCHING UP ON THE IDLE TIME
+            clock_gettime(CLOCK_MONOTONIC, &next);
+            continue;
+        }
+        if (coarseFilter)
+        {
+            coarseFilter = false;
+            filter.setCoarse(false);
+        }
+        // SLEEP TO AN ABSOLUTE DEADLINE SO THE PERIOD DOES NOT DRIFT WITH THE WORK DONE
+        next.tv_nsec += pollingInterval;
+        while (next.tv_nsec >= 1000000000)
+        {
+            next.tv_nsec -= 1000000000;
+            next.tv_sec += 1;
+        }
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, nullptr) == EINTR)
+            ;
+        const qint64 lateness = clockNanos(CLOCK_MONOTONIC) - (qint64(next.tv_sec) * 1000000000 + next.tv_nsec);
+        add<qint64>(wakeLatenessSum, lateness);
+        raise<qint64>(wakeLatenessMax, lateness);
+        wakeLatenessHistogram.record(lateness);
+        if (::poll(&stop, 1, 0) > 0)
+            break;
+    }
+}
+
+bool EdgeCapture::idling() const
+{
+    // ONLY STANDING STILL IDLES.  A MOVING SENSOR KEEPS THE FULL RATE WHETHER ANYONE LISTENS OR
+    // NOT, OR SHORT PULSES WOULD BE MISSED AND THE CUMULATIVE COUNTS FALL BEHIND
+    if (idle.intervalMillis <= 0)
+        return false;
+    return lastPollNanos - lastEdgeNanos > qint64(idle.afterMillis) * 1000000;
+}
+
+bool EdgeCapture::idleWait()
+{
+    struct pollfd fds[2] = { { stopFd, POLLIN, 0 }, { listenFd, POLLIN, 0 } };
+    if (::poll(fds, 2, idle.intervalMillis) < 0 && errno != EINTR)
+        return false;
+    if (fds[0].revents)
+        return false;
+    if (fds[1].revents)
+    {
+        // A CENTRAL SUBSCRIBED.  THE FULL RATE STAYS UNTIL afterMillis WITHOUT AN EDGE
+        quint64 count;
+        if (::read(listenFd, &count, sizeof(count)) == sizeof(count))
+            lastEdgeNanos = input.now();
+    }
+    add<quint64>(idleWakeupCount, 1);
+    return true;
+}
+
+void EdgeCapture::edgeEventLoop()
+{
+#ifdef HAVE_LIBGPIOD
+    QVector<struct pollfd> fds;
+    for (const Pin &pin : pins)
+    {
+        struct pollfd fd = { gpiod_line_event_get_fd(pin.line), POLLIN, 0 };
+        fds.append(fd);
+    }
+    struct pollfd stop = { stopFd, POLLIN, 0 };
+    fds.append(stop);
+    while (running.load(std::memory_order_relaxed))
+    {
+        if (::poll(fds.data(), nfds_t(fds.size()), -1) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            qWarning() << "GPIO edge event wait failed:" << strerror(errno);
+            break;
+        }
+        if (fds.last().revents)
+            break;
+        add<quint64>(wakeupCount, 1);
+        for (int i = 0; i < pins.size(); ++i)
+        {
+            if (fds.at(i).revents & POLLIN)
+                readEdgeEvent(pins[i]);
+        }
+        if (pendingWake)
+            wakeConsumer();
+    }
+#endif
+}
+
+void EdgeCapture::readEdgeEvent(Pin &pin)
+{
+#ifdef HAVE_LIBGPIOD
+    struct gpiod_line_event event;
+    if (gpiod_line_event_read(pin.line, &event) < 0 || event.event_type != GPIOD_LINE_EVENT_RISING_EDGE)
+        return;
+    // THE KERNEL STAMPS EVENTS WITH CLOCK_MONOTONIC
+    const qint64 timestamp = Timebase::fromMonotonic(qint64(event.ts.tv_sec) * 1000000000 + event.ts.tv_nsec);
+    if (filter.accept(pin.pin, timestamp))
+        recordEdge(pin.pin, timestamp, input.now() - timestamp);
+    else
+        refractoryCount.store(filter.refractoryRejects(), std::memory_order_relaxed);
+#else
+    Q_UNUSED(pin);
+#endif
+}
+
+void EdgeCapture::recordEdge(int pin, qint64 timestampNanos, qint64 errorNanos)
+{
+    add<quint64>(edgeCount, 1);
+    add<qint64>(timestampErrorSum, errorNanos);
+    raise<qint64>(timestampErrorMax, errorNanos);
+    Edge edge;
+    edge.pin = pin;
+    edge.timestampNanos = timestampNanos;
+    ring.push(edge);
+    pendingWake = true;
+}
+
+void EdgeCapture::wakeConsumer()
+{
+    // ONE WAKEUP PER CAPTURE PASS, HOWEVER MANY EDGES IT FOUND
+    pendingWake = false;
+    if (wakeFd < 0)
+        return;
+    const quint64 one = 1;
+    if (::write(wakeFd, &one, sizeof(one)) != sizeof(one))
+        return;
+}
+
+void EdgeCapture::reportStats()
+{
+    Stats current = stats();
+    // THE MAXIMA ARE PER INTERVAL: TAKEN AND RESET IN ONE STEP, SO NONE RAISED MEANWHILE IS LOST
+    current.timestampErrorMaxNanos = timestampErrorMax.exchange(0, std::memory_order_relaxed);
+    current.wakeLatenessMaxNanos = wakeLatenessMax.exchange(0, std::memory_order_relaxed);
+    const qint64 wallNanos = SensorInput::monotonicNanos();
+    const qint64 cpuNanos = clockNanos(CLOCK_PROCESS_CPUTIME_ID);
+    const quint64 edges = current.edges - lastReportedStats.edges;
+    const quint64 drained = current.drained - lastReportedStats.drained;
+    const qint64 errorSum = current.timestampErrorSumNanos - lastReportedStats.timestampErrorSumNanos;
+    const qint64 latencySum = current.drainLatencySumNanos - lastReportedStats.drainLatencySumNanos;
+    const quint64 wakeups = current.wakeups - lastReportedStats.wakeups;
+    const qint64 latenessSum = current.wakeLatenessSumNanos - lastReportedStats.wakeLatenessSumNanos;
+    const quint64 idleWakeups = current.idleWakeups - lastReportedStats.idleWakeups;
+    // ONLY FULL RATE WAKEUPS HAVE A DEADLINE TO BE LATE FOR
+    const quint64 timedWakeups = wakeups - idleWakeups;
+    const double cpuPercent = 100.0 * double(cpuNanos - lastReportCpuNanos) / double(wallNanos - lastReportNanos);
+
+    qInfo().nospace() << (currentMode == EdgeEventMode ? "edge" : "poll") << " capture"
+                      << (realTimeActive() ? " (real-time)" : "") << ": "
+                      << edges << " edges, "
+                      << wakeups << " wakeups, "
+                      << cpuPercent << "% cpu, timestamp error avg "
+                      << (edges ? errorSum / qint64(edges) / 1000 : 0) << " us max "
+                      << current.timestampErrorMaxNanos / 1000 << " us, drain latency avg "
+                      << (drained ? latencySum / qint64(drained) / 1000 : 0) << " us max "
+                      << current.drainLatencyMaxNanos / 1000 << " us, ring "
+                      << current.ringHighWater << "/" << ring.capacity() << " high water, "
+                      << current.overflows - lastReportedStats.overflows << " overflows, "
+                      << current.glitches - lastReportedStats.glitches << " glitches and "
+                      << current.refractoryRejects - lastReportedStats.refractoryRejects << " refractory edges filtered";
+    if (currentMode == PollingMode)
+    {
+        qInfo().nospace() << "poll capture wakeup lateness avg " << (timedWakeups ? latenessSum / qint64(timedWakeups) / 1000 : 0)
+                          << " us max " << current.wakeLatenessMaxNanos / 1000 << " us, "
+                          << idleWakeups << " of the wakeups idle";
+    }
+
+    lastReportedStats = current;
+    drainLatencyMax = 0;
+    lastReportNanos = wallNanos;
+    lastReportCpuNanos = cpuNanos;
+}
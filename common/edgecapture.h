@@ -0,0 +1,210 @@
+#ifndef EDGECAPTURE_H
+#define EDGECAPTURE_H
+
+#include "edgefilter.h"
+#include "histogram.h"
+#include "spscring.h"
+
+#include <QtCore/qcommandlineoption.h>
+#include <QtCore/qstring.h>
+#include <QtCore/qtimer.h>
+#include <QtCore/qvector.h>
+#include <atomic>
+#include <functional>
+#include <thread>
+
+class QSocketNotifier;
+class SensorInput;
+struct gpiod_chip;
+struct gpiod_line;
+
+// DELIVERS RISING EDGES OF THE HALL SENSOR PINS TOGETHER WITH A SENSOR CLOCK TIMESTAMP.
+// EDGE EVENT MODE LETS THE KERNEL TIMESTAMP THE EDGE AND ONLY WAKES US WHEN ONE HAPPENED,
+// POLLING MODE SAMPLES THE SENSOR INPUT ON A FIXED PERIOD AND IS KEPT AS A FALLBACK; IT READS
+// EVERY PIN IN ONE BANK READ AND FINDS ALL RISING EDGES AT ONCE WITH levels & ~previous, SO
+// DOZENS OF SENSORS COST ABOUT THE SAME AS ONE.  THE SAMPLES GO THROUGH AN EdgeFilter, SO A
+// SHORT SAMPLING PERIOD DOES NOT TURN MAGNET BOUNCE INTO EXTRA REVOLUTIONS; KERNEL EDGE EVENTS
+// ONLY GET ITS REFRACTORY PERIOD.
+// EITHER WAY DETECTION RUNS ON ITS OWN THREAD, SO BLUETOOTH WORK ON THE QT THREAD CANNOT
+// DELAY IT.  EDGES ARE HANDED OVER THROUGH A LOCK-FREE RING AND DISPATCHED ON THE QT
+// THREAD IN BATCHES BY drain().
+//
+// POLLING DROPS TO A SLOW IDLE PERIOD ONCE NO EDGE HAS COME FOR A WHILE, WHETHER OR NOT A
+// CENTRAL IS SUBSCRIBED, AND GOES BACK TO THE FULL RATE WITH THE FIRST EDGE.  A CENTRAL
+// SUBSCRIBING ONLY CUTS THE CURRENT IDLE SLEEP SHORT.  EDGE EVENT MODE ALREADY SLEEPS UNTIL
+// AN EDGE, SO IT HAS NO IDLE STATE.
+//
+// IN REAL-TIME MODE THE CAPTURE THREAD RUNS SCHED_FIFO, OPTIONALLY PINNED TO ONE (ISOLATED)
+// CPU, WITH THE PROCESS MEMORY LOCKED AND ITS STACK PREFAULTED.  THE CAPTURE LOOPS DO NOT
+// ALLOCATE ONCE STARTED.  ANYTHING THE PROCESS IS NOT ALLOWED TO DO IS LOGGED AND SKIPPED.
+class EdgeCapture
+{
+public:
+    enum Mode
+    {
+        EdgeEventMode,
+        PollingMode
+    };
+    typedef std::function<void(int pin, qint64 timestampNanos)> EdgeHandler;
+    enum
+    {
+        // PINS ARE BITS OF ONE 64 BIT BANK
+        MAX_PINS = 64
+    };
+
+    struct Stats
+    {
+        quint64 edges = 0;
+        quint64 wakeups = 0;
+        // polling: half of the sampling window the edge fell into
+        // edge events: delay between the kernel timestamp and the push into the ring
+        qint64 timestampErrorSumNanos = 0;
+        qint64 timestampErrorMaxNanos = 0;
+        // ring sizing: dropped edges and the fullest the ring has been
+        quint64 overflows = 0;
+        int ringHighWater = 0;
+        // delay between the edge timestamp and its dispatch on the qt thread
+        quint64 drained = 0;
+        qint64 drainLatencySumNanos = 0;
+        qint64 drainLatencyMaxNanos = 0;
+        // polling: how late the capture thread woke up for a sample
+        qint64 wakeLatenessSumNanos = 0;
+        qint64 wakeLatenessMaxNanos = 0;
+        // polling: wakeups at the idle period, part of wakeups
+        quint64 idleWakeups = 0;
+        // level changes too short to count, and rises too soon after the previous one
+        quint64 glitches = 0;
+        quint64 refractoryRejects = 0;
+    };
+    struct RealTimeSettings
+    {
+        bool enabled = false;
+        // SCHED_FIFO PRIORITY, 1 TO 99
+        int priority = 50;
+        // CPU THE CAPTURE THREAD IS PINNED TO, -1 LEAVES IT TO THE SCHEDULER
+        int cpu = -1;
+    };
+    struct IdleSettings
+    {
+        // POLLING PERIOD WHILE IDLE IN MILLISECONDS, 0 ALWAYS POLLS AT THE FULL RATE
+        int intervalMillis = 0;
+        // NO EDGE FOR THIS MANY MILLISECONDS MEANS THE EQUIPMENT IS STANDING STILL
+        int afterMillis = 10000;
+    };
+
+    EdgeCapture(SensorInput &input, Mode mode, qint64 pollingIntervalNanos);
+    ~EdgeCapture();
+
+    // FALSE FOR A PIN OUTSIDE 0 TO MAX_PINS - 1
+    bool addPin(int pin);
+    // BEFORE start()
+    void setRealTime(const RealTimeSettings &settings) { realTime = settings; }
+    void setIdle(const IdleSettings &settings) { idle = settings; }
+    void setFilter(const EdgeFilter::Settings &settings) { filterSettings = settings; }
+    // WHETHER ANY CENTRAL IS SUBSCRIBED (THE DEFAULT).  ONE SUBSCRIBING ONLY CUTS THE CURRENT
+    // IDLE SLEEP SHORT; WHETHER POLLING IDLES DEPENDS ON EDGES ALONE
+    void setListening(bool listening);
+    // TRUE ONCE THE CAPTURE THREAD ACTUALLY RUNS WITH THE REAL-TIME POLICY
+    bool realTimeActive() const { return realTimeRunning.load(std::memory_order_relaxed); }
+    // FALLS BACK TO POLLING IF THE KERNEL EVENT INTERFACE CANNOT BE USED
+    bool start(const EdgeHandler &handler);
+    void stop();
+    Mode mode() const { return currentMode; }
+    // DISPATCHES EVERYTHING QUEUED SO FAR TO THE HANDLER, RETURNS THE NUMBER OF EDGES
+    int drain();
+    Stats stats() const;
+    // EVERY POLLING WAKEUP'S LATENESS.  WRITTEN BY THE CAPTURE THREAD, ONLY READ IT AFTER stop()
+    const Histogram &wakeLateness() const { return wakeLatenessHistogram; }
+    void startStatsReporting(int intervalMillis);
+    // ONE SAMPLE OF EVERY PIN, DRIVEN BY THE CAPTURE THREAD OR DIRECTLY BY A BENCHMARK
+    void poll();
+
+    static QCommandLineOption modeOption();
+    static Mode modeFromString(const QString &value);
+
+private:
+    enum
+    {
+        RING_CAPACITY = 256,
+        DRAIN_BATCH = 32
+    };
+    struct Edge
+    {
+        int pin;
+        qint64 timestampNanos;
+    };
+    struct Pin
+    {
+        int pin;
+        gpiod_line *line;
+    };
+
+    bool openEdgeEvents();
+    void closeEdgeEvents();
+    // CLOSES WHICHEVER OF wakeFd, stopFd AND listenFd ARE OPEN
+    void closeEventFds();
+    void enterRealTime();
+    void pollingLoop();
+    bool idling() const;
+    // SLEEPS ONE IDLE PERIOD, FALSE WHEN STOPPED
+    bool idleWait();
+    void edgeEventLoop();
+    void readEdgeEvent(Pin &pin);
+    void recordEdge(int pin, qint64 timestampNanos, qint64 errorNanos);
+    void wakeConsumer();
+    void reportStats();
+
+    SensorInput &input;
+    Mode currentMode;
+    const qint64 pollingInterval;
+    QVector<Pin> pins;
+    // ONE BIT PER CAPTURED PIN
+    quint64 pinMask = 0;
+    EdgeHandler handler;
+    gpiod_chip *chip = nullptr;
+    RealTimeSettings realTime;
+    IdleSettings idle;
+    EdgeFilter::Settings filterSettings;
+
+    // CAPTURE THREAD
+    std::thread thread;
+    std::atomic<bool> running{false};
+    int wakeFd = -1;
+    int stopFd = -1;
+    // WAKES AN IDLE CAPTURE THREAD WHEN A CENTRAL SUBSCRIBES
+    int listenFd = -1;
+    std::atomic<bool> listening{true};
+    qint64 lastPollNanos = 0;
+    qint64 lastEdgeNanos = 0;
+    bool pendingWake = false;
+    EdgeFilter filter;
+    // THE FILTER IS SET FOR THE IDLE PERIOD
+    bool coarseFilter = false;
+    std::atomic<quint64> edgeCount{0};
+    std::atomic<quint64> wakeupCount{0};
+    std::atomic<quint64> idleWakeupCount{0};
+    std::atomic<quint64> glitchCount{0};
+    std::atomic<quint64> refractoryCount{0};
+    std::atomic<qint64> timestampErrorSum{0};
+    std::atomic<qint64> timestampErrorMax{0};
+    std::atomic<qint64> wakeLatenessSum{0};
+    std::atomic<qint64> wakeLatenessMax{0};
+    std::atomic<bool> realTimeRunning{false};
+    Histogram wakeLatenessHistogram;
+    SpscRing<Edge, RING_CAPACITY> ring;
+
+    // QT THREAD
+    QSocketNotifier *wakeNotifier = nullptr;
+    QTimer statsTimer;
+    quint64 drainedCount = 0;
+    qint64 drainLatencySum = 0;
+    qint64 drainLatencyMax = 0;
+    Stats lastReportedStats;
+    qint64 lastReportNanos = 0;
+    qint64 lastReportCpuNanos = 0;
+
+    EdgeCapture(const EdgeCapture &) = delete;
+    EdgeCapture &operator=(const EdgeCapture &) = delete;
+};
+
+#endif // EDGECAPTURE_H
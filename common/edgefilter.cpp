@@ -0,0 +1,46 @@
+#include "edgefilter.h"
+
+EdgeFilter::EdgeFilter()
+{
+    configure(Settings(), 1);
+    reset(0);
+}
+
+void EdgeFilter::configure(const Settings &filterSettings, qint64 samplePeriodNanos)
+{
+    settings = filterSettings;
+    samplePeriod = qMax<qint64>(1, samplePeriodNanos);
+    refractoryNanos = settings.maxRpm > 0 ? Q_INT64_C(60000000000) / settings.maxRpm : 0;
+    setCoarse(false);
+}
+
+void EdgeFilter::reset(quint64 levels)
+{
+    accepted = levels;
+    pending = 0;
+    for (quint64 &slice : counter)
+        slice = 0;
+    for (qint64 &rise : lastRise)
+        rise = -refractoryNanos;
+}
+
+void EdgeFilter::setCoarse(bool coarse)
+{
+    const int fall = qBound(1, settings.hysteresisSamples, int(MAX_SAMPLES));
+    // A PULSE OF minPulseMicros IS SEEN BY AT LEAST THIS MANY SAMPLES
+    const qint64 pulseSamples = qint64(settings.minPulseMicros) * 1000 / samplePeriod;
+    const int rise = qBound<qint64>(fall, pulseSamples, MAX_SAMPLES);
+    spread(coarse ? 1 : rise, riseTarget);
+    spread(coarse ? 1 : fall, fallTarget);
+    riseDelay = coarse ? 0 : (rise - 1) * samplePeriod;
+    // A COUNT UNDER WAY MAY ALREADY BE PAST THE NEW TARGET
+    pending = 0;
+    for (quint64 &slice : counter)
+        slice = 0;
+}
+
+void EdgeFilter::spread(int samples, quint64 *target)
+{
+    for (int k = 0; k < COUNTER_BITS; ++k)
+        target[k] = (samples >> k & 1) ? ~quint64(0) : 0;
+}
@@ -0,0 +1,117 @@
+#ifndef EDGEFILTER_H
+#define EDGEFILTER_H
+
+#include <QtCore/qglobal.h>
+
+// DEBOUNCE AND GLITCH FILTER BETWEEN THE RAW PIN SAMPLES AND THE EDGE COUNTERS, SO MAGNET
+// BOUNCE AND ELECTRICAL NOISE DO NOT COUNT EXTRA REVOLUTIONS WHEN SAMPLING FAST.
+//
+// LIKE THE POLLING ITSELF IT WORKS ON THE WHOLE 64 PIN BANK AT ONCE.  EVERY PIN HAS A COUNTER
+// OF CONSECUTIVE SAMPLES DISAGREEING WITH ITS ACCEPTED LEVEL, STORED BIT-SLICED (BIT k OF
+// EVERY PIN'S COUNTER IN WORD k), SO ONE step() IS A FIXED HANDFUL OF AND/XOR OPERATIONS
+// WITHOUT BRANCHES, HOWEVER MANY PINS THERE ARE.  A LEVEL IS ACCEPTED ONCE IT HELD FOR THE
+// HYSTERESIS COUNT (A RISE ALSO FOR THE MINIMUM PULSE WIDTH), AND AN ACCEPTED RISE SOONER
+// THAN ONE REVOLUTION AT THE MAXIMUM PLAUSIBLE RPM AFTER THE PREVIOUS ONE IS DROPPED.
+class EdgeFilter
+{
+public:
+    enum
+    {
+        // THE COUNTERS ARE 4 BITS WIDE
+        MAX_SAMPLES = 15,
+        MAX_PINS = 64
+    };
+    struct Settings
+    {
+        // CONSECUTIVE SAMPLES A NEW LEVEL MUST HOLD BEFORE IT COUNTS, 1 TURNS THIS OFF
+        int hysteresisSamples = 1;
+        // A RISE ONLY COUNTS ONCE THE PIN HAS BEEN HIGH THIS LONG, 0 TURNS THIS OFF
+        int minPulseMicros = 0;
+        // FASTEST PLAUSIBLE SENSOR; A RISE WITHIN ONE REVOLUTION AT THIS RATE OF THE PREVIOUS
+        // ONE IS BOUNCE.  0 TURNS THIS OFF
+        int maxRpm = 0;
+    };
+
+    // PASSES EVERY RISE UNTIL configure()
+    EdgeFilter();
+
+    // THE SAMPLE PERIOD TURNS THE MINIMUM PULSE WIDTH INTO SAMPLES.  FOLLOW WITH reset()
+    void configure(const Settings &settings, qint64 samplePeriodNanos);
+    // STARTS OVER FROM THESE LEVELS, WITH NO EDGE
+    void reset(quint64 levels);
+    // WHILE SAMPLING COARSELY (IDLE POLLING) ONE SAMPLE IS ENOUGH: A PULSE IS SHORTER THAN
+    // A FEW IDLE PERIODS, SO WAITING FOR MORE WOULD MISS THE WHEEL STARTING
+    void setCoarse(bool coarse);
+
+    // ONE SAMPLE OF THE BANK IN, THE PINS WITH A NEWLY ACCEPTED RISE OUT
+    quint64 step(quint64 levels)
+    {
+        const quint64 disagree = levels ^ accepted;
+        // INCREMENT WHERE THE SAMPLE DISAGREES, CLEAR WHERE IT AGREES (A GLITCH ENDED)
+        quint64 carry = disagree;
+        for (int k = 0; k < COUNTER_BITS; ++k)
+        {
+            const quint64 next = counter[k] & carry;
+            counter[k] = (counter[k] ^ carry) & disagree;
+            carry = next;
+        }
+        glitchCount += quint64(__builtin_popcountll(pending & ~disagree));
+        const quint64 flip = disagree & ((~accepted & reached(riseTarget)) | (accepted & reached(fallTarget)));
+        accepted ^= flip;
+        for (int k = 0; k < COUNTER_BITS; ++k)
+            counter[k] &= ~flip;
+        pending = disagree & ~flip;
+        return flip & accepted;
+    }
+
+    // CALLED FOR EVERY RISE step() ACCEPTED, AND FOR KERNEL EDGE EVENTS.  FALSE WITHIN THE
+    // REFRACTORY PERIOD OF THE PIN'S PREVIOUS RISE
+    bool accept(int pin, qint64 timestampNanos)
+    {
+        if (timestampNanos - lastRise[pin] < refractoryNanos)
+        {
+            ++refractoryCount;
+            return false;
+        }
+        lastRise[pin] = timestampNanos;
+        return true;
+    }
+
+    // HOW LONG AFTER THE FIRST HIGH SAMPLE step() REPORTS A RISE
+    qint64 riseDelayNanos() const { return riseDelay; }
+    // LEVEL CHANGES THAT DID NOT HOLD LONG ENOUGH, AND RISES TOO CLOSE TO THE PREVIOUS ONE
+    quint64 glitches() const { return glitchCount; }
+    quint64 refractoryRejects() const { return refractoryCount; }
+
+private:
+    enum
+    {
+        COUNTER_BITS = 4
+    };
+
+    // PINS WHOSE COUNTER EQUALS THE TARGET, WHOSE BITS ARE SPREAD TO ALL-ONES OR ALL-ZERO WORDS
+    quint64 reached(const quint64 *target) const
+    {
+        quint64 equal = ~quint64(0);
+        for (int k = 0; k < COUNTER_BITS; ++k)
+            equal &= ~(counter[k] ^ target[k]);
+        return equal;
+    }
+    static void spread(int samples, quint64 *target);
+
+    Settings settings;
+    qint64 samplePeriod = 0;
+    quint64 riseTarget[COUNTER_BITS] = {};
+    quint64 fallTarget[COUNTER_BITS] = {};
+    qint64 riseDelay = 0;
+    qint64 refractoryNanos = 0;
+    quint64 accepted = 0;
+    // PINS WHOSE COUNTER WAS RUNNING AFTER THE PREVIOUS SAMPLE
+    quint64 pending = 0;
+    quint64 counter[COUNTER_BITS] = {};
+    qint64 lastRise[MAX_PINS];
+    quint64 glitchCount = 0;
+    quint64 refractoryCount = 0;
+};
+
+#endif // EDGEFILTER_H
@@ -0,0 +1,92 @@
+#include "ftmsservice.h"
+#include "sensorinput.h"
+
+#include <QtBluetooth/qlowenergycharacteristic.h>
+#include <QtBluetooth/qlowenergycharacteristicdata.h>
+#include <QtBluetooth/qlowenergydescriptordata.h>
+
+namespace
+{
+typedef TreadmillDataEncoder<TreadmillData::AverageSpeedPresent | TreadmillData::TotalDistancePresent
+                             | TreadmillData::ElapsedTimePresent> Encoder;
+
+// ASSIGNED NUMBERS QT HAS NO NAMES FOR
+const quint16 FITNESS_MACHINE_SERVICE = 0x1826;
+const quint16 FITNESS_MACHINE_FEATURE = 0x2acc;
+const quint16 TREADMILL_DATA = 0x2acd;
+
+// 1/256 M/S TO 1/100 KM/H: * 3.6 * 100 / 256 == * 45 / 32
+quint16 hundredthKilometersPerHour(int speed)
+{
+    return quint16(speed * 45 / 32);
+}
+}
+
+FtmsService::FtmsService(SensorInput &clock, int beltPin, int distancePerRevolution, const SpeedEstimator::Settings &speedSettings)
+    : MeasurementService(clock, QBluetoothUuid(FITNESS_MACHINE_SERVICE), QBluetoothUuid(TREADMILL_DATA)),
+      beltPin(beltPin), distancePerRevolution(distancePerRevolution), stopTimeoutNanos(speedSettings.stopTimeoutNanos),
+      speedEstimator(distancePerRevolution, speedSettings)
+{
+    data.instantaneousSpeed = 0;
+    data.averageSpeed = 0;
+    data.totalDistance = 0;
+    data.elapsedTime = 0;
+
+    // SET UP CHARACTERISTIC DATA FOR TREADMILL DATA
+    QLowEnergyCharacteristicData treadmillData;
+    treadmillData.setUuid(QBluetoothUuid(TREADMILL_DATA));
+    treadmillData.setValue(QByteArray(Encoder::Size, 0));
+    treadmillData.setProperties(QLowEnergyCharacteristic::Notify);
+    const QLowEnergyDescriptorData clientConfig(QBluetoothUuid::ClientCharacteristicConfiguration,
+                                              QByteArray(2, 0));
+    treadmillData.addDescriptor(clientConfig);
+
+    // SET UP THE FITNESS MACHINE FEATURE: MACHINE FEATURES, THEN TARGET SETTINGS (NONE)
+    QLowEnergyCharacteristicData featureData;
+    featureData.setUuid(QBluetoothUuid(FITNESS_MACHINE_FEATURE));
+    QByteArray featureBytes(8, 0);
+    MeasurementEncoding::putUInt32(featureBytes.data(),
+                                   TreadmillData::AverageSpeedSupported
+                                       | TreadmillData::TotalDistanceSupported
+                                       | TreadmillData::ElapsedTimeSupported);
+    featureData.setValue(featureBytes);
+    featureData.setProperties(QLowEnergyCharacteristic::Read);
+
+    // NOW COLLECT ALL CHARACTERISTICS AND ATTACH TO SERVICE
+    serviceData.addCharacteristic(treadmillData);
+    serviceData.addCharacteristic(featureData);
+}
+
+QList<int> FtmsService::pins() const
+{
+    return QList<int>() << beltPin;
+}
+
+void FtmsService::handleEdge(int, qint64 timestampNanos)
+{
+    speedEstimator.addEdge(timestampNanos);
+    sessionMillimeters += distancePerRevolution;
+    beltRevolutions += 1;
+    const qint64 gap = timestampNanos - lastEdgeNanos;
+    if (lastEdgeNanos >= 0 && gap <= stopTimeoutNanos)
+    {
+        movingNanos += gap;
+        movingMillimeters += distancePerRevolution;
+    }
+    lastEdgeNanos = timestampNanos;
+    measurementChanged(timestampNanos);
+}
+
+void FtmsService::report()
+{
+    speedEstimator.update(clock.now());
+    data.instantaneousSpeed = hundredthKilometersPerHour(speedEstimator.speed());
+    // MM / NS TO 1/100 KM/H: * 10^6 * 3.6 * 100
+    data.averageSpeed = quint16(movingNanos ? movingMillimeters * 360000000 / movingNanos : 0);
+    data.totalDistance = quint32(qMin<qint64>(sessionMillimeters / 1000, 0xffffff));
+    data.elapsedTime = quint16(qMin<qint64>(movingNanos / 1000000000, 0xffff));
+    if (publishesTelemetry())
+        publishTelemetry(beltTelemetry(beltRevolutions, lastEdgeNanos, speedEstimator.speed(), 0, distancePerRevolution,
+                                       quint32(sessionMillimeters / 100), clock.now()));
+    sendMeasurement(packet, Encoder::encode(data, packet));
+}
@@ -0,0 +1,41 @@
+#ifndef FTMSSERVICE_H
+#define FTMSSERVICE_H
+
+#include "measurementencoder.h"
+#include "measurementservice.h"
+#include "speedestimator.h"
+
+// FITNESS MACHINE SERVICE AS A TREADMILL, FROM THE SAME BELT SENSOR AS THE RSC SERVICE.  ONE
+// TREADMILL DATA NOTIFICATION CARRIES INSTANTANEOUS AND AVERAGE SPEED, TOTAL DISTANCE AND
+// ELAPSED TIME OF THE SESSION, SO APPS DO NOT HAVE TO ESTIMATE THEM.  THE SESSION STARTS WITH
+// THE FIRST BELT EDGE; ELAPSED TIME AND AVERAGE SPEED ONLY COUNT WHILE THE BELT MOVES.
+class FtmsService : public MeasurementService
+{
+public:
+    // DISTANCE TRAVELLED IN ONE REVOLUTION OF THE TREADMILL IN MILLIMETERS
+    FtmsService(SensorInput &clock, int beltPin, int distancePerRevolution, const SpeedEstimator::Settings &speedSettings);
+
+    const char *name() const override { return "ftms"; }
+    QList<int> pins() const override;
+    void handleEdge(int pin, qint64 timestampNanos) override;
+
+protected:
+    void report() override;
+
+private:
+    const int beltPin;
+    const int distancePerRevolution;
+    // A GAP LONGER THAN THIS BETWEEN EDGES IS A PAUSE, NOT ELAPSED TIME
+    const qint64 stopTimeoutNanos;
+    SpeedEstimator speedEstimator;
+    qint64 lastEdgeNanos = -1;
+    quint32 beltRevolutions = 0;
+    // THE WHOLE SESSION, AND ONLY THE PART COVERED WHILE MOVING (FOR THE AVERAGE)
+    qint64 sessionMillimeters = 0;
+    qint64 movingMillimeters = 0;
+    qint64 movingNanos = 0;
+    TreadmillData data;
+    char packet[MAX_MEASUREMENT_SIZE];
+};
+
+#endif // FTMSSERVICE_H
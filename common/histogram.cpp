@@ -0,0 +1,55 @@
+#include "histogram.h"
+
+#include <QtCore/qstring.h>
+#include <QtCore/qtextstream.h>
+
+namespace
+{
+// PROMETHEUS BUCKET BOUNDARIES IN NANOSECONDS, 1-2-5 STEPS FROM 1 US TO 10 S
+const quint64 EXPORTED_BOUNDS[] = {
+    1000, 2000, 5000, 10000, 20000, 50000, 100000, 200000, 500000,
+    1000000, 2000000, 5000000, 10000000, 20000000, 50000000, 100000000, 200000000, 500000000,
+    1000000000, 2000000000, 5000000000, 10000000000
+};
+}
+
+quint64 Histogram::upperBound(int bucket)
+{
+    if (bucket < SUB_BUCKETS)
+        return quint64(bucket);
+    const int magnitude = bucket / SUB_BUCKETS + SUB_BUCKET_BITS - 1;
+    const int subBucket = bucket % SUB_BUCKETS;
+    return (quint64(SUB_BUCKETS + subBucket + 1) << (magnitude - SUB_BUCKET_BITS)) - 1;
+}
+
+quint64 Histogram::quantileNanos(double q) const
+{
+    if (total == 0)
+        return 0;
+    const quint64 rank = qMax(quint64(1), quint64(q * double(total) + 0.5));
+    quint64 seen = 0;
+    for (int bucket = 0; bucket < BUCKETS; ++bucket)
+    {
+        seen += counts[bucket];
+        if (seen >= rank)
+            return qMin(upperBound(bucket), maximum);
+    }
+    return maximum;
+}
+
+void Histogram::writePrometheus(QTextStream &out, const char *name, const QString &labels) const
+{
+    // A BUCKET IS COUNTED UNDER THE FIRST BOUNDARY ITS WHOLE RANGE FITS BELOW
+    const QString separator = labels.isEmpty() ? QString() : QStringLiteral(",");
+    quint64 cumulative = 0;
+    int bucket = 0;
+    for (quint64 bound : EXPORTED_BOUNDS)
+    {
+        for (; bucket < BUCKETS && upperBound(bucket) <= bound; ++bucket)
+            cumulative += counts[bucket];
+        out << name << "_bucket{" << labels << separator << "le=\"" << double(bound) / 1e9 << "\"} " << cumulative << '\n';
+    }
+    out << name << "_bucket{" << labels << separator << "le=\"+Inf\"} " << total << '\n';
+    out << name << "_sum{" << labels << "} " << double(sum) / 1e9 << '\n';
+    out << name << "_count{" << labels << "} " << total << '\n';
+}
@@ -0,0 +1,64 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <QtCore/qglobal.h>
+
+class QString;
+class QTextStream;
+
+// LOG-LINEAR (HDR STYLE) HISTOGRAM OF DURATIONS IN NANOSECONDS: EVERY POWER OF TWO IS SPLIT
+// INTO 8 BUCKETS, SO ANY VALUE IS KEPT TO WITHIN 12.5% FROM 1 NS TO OVER AN HOUR.  record()
+// IS A BIT SCAN, A SHIFT AND FOUR ADDS; NO DIVISION AND NO ALLOCATION, WHICH KEEPS IT CHEAP
+// ENOUGH FOR EVERY EDGE EVEN ON A PI ZERO.  NOT THREAD SAFE, EACH ONE BELONGS TO ONE THREAD.
+class Histogram
+{
+public:
+    enum
+    {
+        SUB_BUCKET_BITS = 3,
+        SUB_BUCKETS = 1 << SUB_BUCKET_BITS,
+        // 2^42 NS IS ABOUT 73 MINUTES, ANYTHING LONGER LANDS IN THE LAST BUCKET
+        MAX_MAGNITUDE = 42,
+        BUCKETS = (MAX_MAGNITUDE - SUB_BUCKET_BITS + 2) * SUB_BUCKETS
+    };
+
+    void record(qint64 nanos)
+    {
+        const quint64 value = nanos > 0 ? quint64(nanos) : 0;
+        ++counts[bucketOf(value)];
+        ++total;
+        sum += value;
+        if (value > maximum)
+            maximum = value;
+    }
+
+    quint64 count() const { return total; }
+    quint64 sumNanos() const { return sum; }
+    quint64 maxNanos() const { return maximum; }
+    // UPPER BOUND OF THE BUCKET HOLDING THE q QUANTILE, 0 WHEN EMPTY
+    quint64 quantileNanos(double q) const;
+
+    // PROMETHEUS HISTOGRAM IN SECONDS.  labels IS EITHER EMPTY OR LIKE service="csc"
+    void writePrometheus(QTextStream &out, const char *name, const QString &labels) const;
+
+    static int bucketOf(quint64 value)
+    {
+        if (value < SUB_BUCKETS)
+            return int(value);
+        int magnitude = 63 - __builtin_clzll(value);
+        if (magnitude > MAX_MAGNITUDE)
+            return BUCKETS - 1;
+        const int subBucket = int(value >> (magnitude - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1);
+        return (magnitude - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + subBucket;
+    }
+    // LARGEST VALUE THAT FALLS INTO bucket
+    static quint64 upperBound(int bucket);
+
+private:
+    quint64 counts[BUCKETS] = {};
+    quint64 total = 0;
+    quint64 sum = 0;
+    quint64 maximum = 0;
+};
+
+#endif // HISTOGRAM_H
@@ -0,0 +1,212 @@
+#ifndef MEASUREMENTENCODER_H
+#define MEASUREMENTENCODER_H
+
+#include <QtCore/qglobal.h>
+
+// CSC, RSC AND FTMS TREADMILL MEASUREMENT PACKETS.  THE FLAGS ARE A TEMPLATE ARGUMENT, SO THE FIELD OFFSETS
+// AND PACKET SIZE ARE COMPILE TIME CONSTANTS AND encode() IS A HANDFUL OF BYTE STORES INTO A
+// BUFFER THE CALLER PREALLOCATED.  NOTHING HERE ALLOCATES.
+
+namespace MeasurementEncoding
+{
+inline void putUInt16(char *out, quint16 value)
+{
+    out[0] = char(value & 0xff);
+    out[1] = char(value >> 8);
+}
+
+inline void putUInt24(char *out, quint32 value)
+{
+    out[0] = char(value & 0xff);
+    out[1] = char((value >> 8) & 0xff);
+    out[2] = char((value >> 16) & 0xff);
+}
+
+inline void putUInt32(char *out, quint32 value)
+{
+    out[0] = char(value & 0xff);
+    out[1] = char((value >> 8) & 0xff);
+    out[2] = char((value >> 16) & 0xff);
+    out[3] = char(value >> 24);
+}
+
+// EVENT TIMES ARE IN 1/1024 SECOND AND WRAP EVERY 64 SECONDS.  1024 / 10^9 == 2 / 1953125
+inline quint16 eventTime(qint64 nanos)
+{
+    return quint16(quint64(nanos) * 2 / 1953125);
+}
+}
+
+// ************************************
+// CYCLING SPEED AND CADENCE
+struct CscMeasurement
+{
+    enum Flags
+    {
+        WheelRevolutionDataPresent = 0x01,
+        CrankRevolutionDataPresent = 0x02
+    };
+    // CSC FEATURE BITS MATCH THE MEASUREMENT FLAGS
+    enum Features
+    {
+        WheelRevolutionDataSupported = 0x0001,
+        CrankRevolutionDataSupported = 0x0002
+    };
+
+    quint32 cumulativeWheelRevolutions;
+    quint16 lastWheelEventTime;
+    quint16 cumulativeCrankRevolutions;
+    quint16 lastCrankEventTime;
+};
+
+template <quint8 Flags>
+class CscMeasurementEncoder
+{
+public:
+    enum
+    {
+        WheelOffset = 1,
+        CrankOffset = WheelOffset + ((Flags & CscMeasurement::WheelRevolutionDataPresent) ? 6 : 0),
+        Size = CrankOffset + ((Flags & CscMeasurement::CrankRevolutionDataPresent) ? 4 : 0)
+    };
+
+    static int encode(const CscMeasurement &measurement, char *out)
+    {
+        out[0] = char(Flags);
+        if (Flags & CscMeasurement::WheelRevolutionDataPresent)
+        {
+            MeasurementEncoding::putUInt32(out + WheelOffset, measurement.cumulativeWheelRevolutions);
+            MeasurementEncoding::putUInt16(out + WheelOffset + 4, measurement.lastWheelEventTime);
+        }
+        if (Flags & CscMeasurement::CrankRevolutionDataPresent)
+        {
+            MeasurementEncoding::putUInt16(out + CrankOffset, measurement.cumulativeCrankRevolutions);
+            MeasurementEncoding::putUInt16(out + CrankOffset + 2, measurement.lastCrankEventTime);
+        }
+        return Size;
+    }
+};
+
+// ************************************
+// RUNNING SPEED AND CADENCE
+struct RscMeasurement
+{
+    enum Flags
+    {
+        InstantaneousStrideLengthPresent = 0x01,
+        TotalDistancePresent = 0x02,
+        Running = 0x04
+    };
+    enum Features
+    {
+        InstantaneousStrideLengthSupported = 0x0001,
+        TotalDistanceSupported = 0x0002,
+        WalkingOrRunningStatusSupported = 0x0004
+    };
+
+    // 1/256 m/s
+    quint16 instantaneousSpeed;
+    // steps per minute
+    quint8 instantaneousCadence;
+    // 1/100 m
+    quint16 instantaneousStrideLength;
+    // 1/10 m
+    quint32 totalDistance;
+    // walking or running status bit, sent with every layout
+    bool running;
+};
+
+// FLAGS SELECT THE OPTIONAL FIELDS, THE RUNNING STATUS BIT COMES FROM THE MEASUREMENT
+template <quint8 Flags>
+class RscMeasurementEncoder
+{
+public:
+    enum
+    {
+        StrideLengthOffset = 4,
+        TotalDistanceOffset = StrideLengthOffset + ((Flags & RscMeasurement::InstantaneousStrideLengthPresent) ? 2 : 0),
+        Size = TotalDistanceOffset + ((Flags & RscMeasurement::TotalDistancePresent) ? 4 : 0)
+    };
+
+    static int encode(const RscMeasurement &measurement, char *out)
+    {
+        out[0] = char((Flags & ~RscMeasurement::Running) | (measurement.running ? RscMeasurement::Running : 0));
+        MeasurementEncoding::putUInt16(out + 1, measurement.instantaneousSpeed);
+        out[3] = char(measurement.instantaneousCadence);
+        if (Flags & RscMeasurement::InstantaneousStrideLengthPresent)
+            MeasurementEncoding::putUInt16(out + StrideLengthOffset, measurement.instantaneousStrideLength);
+        if (Flags & RscMeasurement::TotalDistancePresent)
+            MeasurementEncoding::putUInt32(out + TotalDistanceOffset, measurement.totalDistance);
+        return Size;
+    }
+};
+
+// ************************************
+// FITNESS MACHINE TREADMILL DATA
+struct TreadmillData
+{
+    enum Flags
+    {
+        // INVERTED: INSTANTANEOUS SPEED IS PRESENT WHILE THIS BIT IS CLEAR
+        MoreData = 0x0001,
+        AverageSpeedPresent = 0x0002,
+        TotalDistancePresent = 0x0004,
+        ElapsedTimePresent = 0x0400
+    };
+    // FITNESS MACHINE FEATURE BITS
+    enum Features
+    {
+        AverageSpeedSupported = 0x00000001,
+        TotalDistanceSupported = 0x00000004,
+        ElapsedTimeSupported = 0x00001000
+    };
+
+    // 1/100 km/h
+    quint16 instantaneousSpeed;
+    quint16 averageSpeed;
+    // meters, 24 bits
+    quint32 totalDistance;
+    // seconds
+    quint16 elapsedTime;
+};
+
+// FIELDS FOLLOW THE 16 BIT FLAGS IN FLAG BIT ORDER.  ONLY THE FIELDS THE BELT SENSOR CAN
+// PROVIDE ARE IMPLEMENTED
+template <quint16 Flags>
+class TreadmillDataEncoder
+{
+public:
+    enum
+    {
+        InstantaneousSpeedOffset = 2,
+        AverageSpeedOffset = InstantaneousSpeedOffset + ((Flags & TreadmillData::MoreData) ? 0 : 2),
+        TotalDistanceOffset = AverageSpeedOffset + ((Flags & TreadmillData::AverageSpeedPresent) ? 2 : 0),
+        ElapsedTimeOffset = TotalDistanceOffset + ((Flags & TreadmillData::TotalDistancePresent) ? 3 : 0),
+        Size = ElapsedTimeOffset + ((Flags & TreadmillData::ElapsedTimePresent) ? 2 : 0)
+    };
+
+    static int encode(const TreadmillData &data, char *out)
+    {
+        MeasurementEncoding::putUInt16(out, Flags);
+        if (!(Flags & TreadmillData::MoreData))
+            MeasurementEncoding::putUInt16(out + InstantaneousSpeedOffset, data.instantaneousSpeed);
+        if (Flags & TreadmillData::AverageSpeedPresent)
+            MeasurementEncoding::putUInt16(out + AverageSpeedOffset, data.averageSpeed);
+        if (Flags & TreadmillData::TotalDistancePresent)
+            MeasurementEncoding::putUInt24(out + TotalDistanceOffset, data.totalDistance);
+        if (Flags & TreadmillData::ElapsedTimePresent)
+            MeasurementEncoding::putUInt16(out + ElapsedTimeOffset, data.elapsedTime);
+        return Size;
+    }
+};
+
+// LARGEST PACKET ANY FLAG COMBINATION PRODUCES, FOR SIZING THE PREALLOCATED BUFFERS
+enum
+{
+    MAX_MEASUREMENT_SIZE = 11
+};
+static_assert(int(CscMeasurementEncoder<0x03>::Size) <= int(MAX_MEASUREMENT_SIZE), "csc buffer too small");
+static_assert(int(RscMeasurementEncoder<0x07>::Size) <= int(MAX_MEASUREMENT_SIZE), "rsc buffer too small");
+static_assert(int(TreadmillDataEncoder<0x0406>::Size) <= int(MAX_MEASUREMENT_SIZE), "treadmill buffer too small");
+
+#endif // MEASUREMENTENCODER_H
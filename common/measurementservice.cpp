@@ -0,0 +1,223 @@
+#include "measurementservice.h"
+#include "measurementencoder.h"
+#include "sensorinput.h"
+#include "sessionrecorder.h"
+#include "telemetrypublisher.h"
+
+#include <QtBluetooth/qlowenergycontroller.h>
+#include <QtBluetooth/qlowenergydescriptor.h>
+#include <QtBluetooth/qlowenergyservice.h>
+
+namespace
+{
+// BIT 0 OF THE CLIENT CHARACTERISTIC CONFIGURATION ENABLES NOTIFICATIONS
+bool notificationsEnabled(const QByteArray &clientConfig)
+{
+    return !clientConfig.isEmpty() && (clientConfig.at(0) & 1);
+}
+}
+
+MeasurementService::MeasurementService(SensorInput &clock, const QBluetoothUuid &serviceUuid, const QBluetoothUuid &measurementUuid)
+    : clock(clock), serviceUuid(serviceUuid), measurementUuid(measurementUuid),
+      scheduler([this]() { return notify(); })
+{
+    serviceData.setType(QLowEnergyServiceData::ServiceTypePrimary);
+    serviceData.setUuid(serviceUuid);
+}
+
+MeasurementService::~MeasurementService()
+{
+    qDeleteAll(subscribers);
+}
+
+bool MeasurementService::attach(int central, QLowEnergyController *controller)
+{
+    detach(central);
+    QScopedPointer<Subscriber> subscriber(new Subscriber);
+    subscriber->central = central;
+    subscriber->controller = controller;
+    subscriber->service.reset(controller->addService(serviceData));
+    if (subscriber->service.isNull())
+        return false;
+    subscriber->measurementCharacteristic = subscriber->service->characteristic(measurementUuid);
+    Q_ASSERT(subscriber->measurementCharacteristic.isValid());
+    readSubscription(subscriber.data());
+
+    // THE SUBSCRIBER OUTLIVES NEITHER ITS SERVICE NOR THESE CONNECTIONS
+    Subscriber *const entry = subscriber.data();
+    QLowEnergyService *const service = entry->service.data();
+    QObject::connect(service, &QLowEnergyService::descriptorWritten, service,
+                     [this, entry](const QLowEnergyDescriptor &descriptor, const QByteArray &value) {
+        if (descriptor.uuid() != QBluetoothUuid(QBluetoothUuid::ClientCharacteristicConfiguration))
+            return;
+        entry->subscribed = notificationsEnabled(value);
+        subscriptionsChanged();
+    });
+    QObject::connect(service, static_cast<void (QLowEnergyService::*)(QLowEnergyService::ServiceError)>(&QLowEnergyService::error), service,
+                     [entry](QLowEnergyService::ServiceError error) {
+        if (error == QLowEnergyService::CharacteristicWriteError)
+            ++entry->counters.dropped;
+    });
+    subscribers.append(subscriber.take());
+    return true;
+}
+
+void MeasurementService::readSubscription(Subscriber *subscriber)
+{
+    // A BONDED CENTRAL MAY COME BACK WITH ITS SUBSCRIPTION ALREADY RESTORED
+    subscriber->subscribed = notificationsEnabled(
+        subscriber->measurementCharacteristic.descriptor(QBluetoothUuid::ClientCharacteristicConfiguration).value());
+}
+
+void MeasurementService::detach(int central)
+{
+    const int index = indexOf(central);
+    if (index >= 0)
+        delete subscribers.takeAt(index);
+}
+
+void MeasurementService::enableMetrics()
+{
+    serviceMetrics.enabled = true;
+    scheduler.setLatenessHistogram(&serviceMetrics.timerLateness);
+}
+
+MeasurementService::FanOutCounters MeasurementService::fanOutCounters(int central) const
+{
+    const int index = indexOf(central);
+    return index >= 0 ? subscribers.at(index)->counters : FanOutCounters();
+}
+
+int MeasurementService::indexOf(int central) const
+{
+    for (int i = 0; i < subscribers.size(); ++i)
+    {
+        if (subscribers.at(i)->central == central)
+            return i;
+    }
+    return -1;
+}
+
+bool MeasurementService::receiving(const Subscriber *subscriber) const
+{
+    return subscriber->subscribed && subscriber->controller->state() == QLowEnergyController::ConnectedState;
+}
+
+void MeasurementService::subscriptionsChanged()
+{
+    if (hasReceivers())
+        scheduler.resume();
+    if (subscriptionCallback)
+        subscriptionCallback();
+}
+
+void MeasurementService::timeOnSensorClock()
+{
+    scheduler.setManualClock([this]() { return clock.now(); });
+}
+
+void MeasurementService::setTelemetry(TelemetryPublisher *publisher, int station)
+{
+    telemetry = publisher;
+    telemetryStation = station;
+    subscriptionsChanged();
+}
+
+bool MeasurementService::hasReceivers() const
+{
+    if (sink || telemetry)
+        return true;
+    for (const Subscriber *subscriber : subscribers)
+    {
+        if (receiving(subscriber))
+            return true;
+    }
+    return false;
+}
+
+bool MeasurementService::notify()
+{
+    // NOBODY TO RECEIVE IT, SO DO NOT EVEN ENCODE IT
+    if (!hasReceivers())
+        return false;
+    report();
+    return true;
+}
+
+void MeasurementService::publishTelemetry(const Telemetry::Values &values)
+{
+    if (telemetry)
+        telemetry->publish(telemetryStation, values);
+}
+
+Telemetry::Values MeasurementService::beltTelemetry(quint32 revolutions, qint64 lastEdgeNanos, int speed, int cadence,
+                                                   int distancePerRevolution, quint32 totalDistance, qint64 nowNanos)
+{
+    Telemetry::Values values;
+    values.updatedNanos = nowNanos;
+    values.wheelRevolutions = revolutions;
+    values.crankRevolutions = 0;
+    values.lastWheelEdgeNanos = lastEdgeNanos;
+    values.lastCrankEdgeNanos = -1;
+    values.lastWheelEventTime = quint16(lastEdgeNanos >= 0 ? MeasurementEncoding::eventTime(lastEdgeNanos) : 0);
+    values.lastCrankEventTime = 0;
+    values.speed = quint16(speed);
+    values.cadence = quint16(cadence);
+    // 1/256 M/S OVER MILLIMETERS PER REVOLUTION TO 1/100 RPM: * 1000 / 256 * 60 * 100
+    values.wheelRpm = quint32(qint64(speed) * 6000000 / (256 * qint64(distancePerRevolution)));
+    values.totalDistance = totalDistance;
+    return values;
+}
+
+void MeasurementService::sendMeasurement(const char *value, int size)
+{
+    // qt keeps the value it notifies, so this copy is the one allocation per notification.
+    // every subscriber shares it
+    const QByteArray measurement(value, size);
+    if (recorder)
+        recorder->recordNotification(measurementUuid.toUInt16(), clock.now(), value, size);
+    ++serviceMetrics.notifications;
+    if (serviceMetrics.enabled && oldestUnsentEdge >= 0)
+        serviceMetrics.edgeToNotify.record(clock.now() - oldestUnsentEdge);
+    oldestUnsentEdge = -1;
+    // THE FAN-OUT LATENCY IS PART OF THE METRICS, SO WITHOUT THEM NOTHING HERE READS THE CLOCK
+    const bool timed = serviceMetrics.enabled;
+    const qint64 encoded = timed ? SensorInput::monotonicNanos() : 0;
+    // EACH CALL STARTS WHERE THE PREVIOUS ONE ENDED, SO TIMING THEM TAKES NO EXTRA CLOCK READS
+    qint64 callStart = encoded;
+    if (sink)
+    {
+        sink(measurement);
+        if (timed)
+            serviceMetrics.notifyCall.record(SensorInput::monotonicNanos() - callStart);
+        return;
+    }
+    for (Subscriber *subscriber : subscribers)
+    {
+        if (!subscriber->subscribed)
+            continue;
+        FanOutCounters &counters = subscriber->counters;
+        if (subscriber->controller->state() != QLowEnergyController::ConnectedState)
+        {
+            ++counters.dropped;
+            continue;
+        }
+        subscriber->service->writeCharacteristic(subscriber->measurementCharacteristic, measurement); // Do the notify.
+        ++counters.sent;
+        if (timed)
+        {
+            const qint64 handedOver = SensorInput::monotonicNanos();
+            const qint64 latency = handedOver - encoded;
+            serviceMetrics.notifyCall.record(handedOver - callStart);
+            callStart = handedOver;
+            counters.totalLatencyNanos += latency;
+            counters.maxLatencyNanos = qMax(counters.maxLatencyNanos, latency);
+        }
+        if (subscriber->firstNotificationPending)
+        {
+            subscriber->firstNotificationPending = false;
+            if (firstNotification)
+                firstNotification(subscriber->central);
+        }
+    }
+}
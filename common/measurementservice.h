@@ -0,0 +1,178 @@
+#ifndef MEASUREMENTSERVICE_H
+#define MEASUREMENTSERVICE_H
+
+#include "histogram.h"
+#include "notificationscheduler.h"
+#include "telemetrylayout.h"
+
+#include <QtBluetooth/qbluetoothuuid.h>
+#include <QtBluetooth/qlowenergycharacteristic.h>
+#include <QtBluetooth/qlowenergyservicedata.h>
+#include <QtCore/qlist.h>
+#include <QtCore/qscopedpointer.h>
+#include <QtCore/qstring.h>
+#include <functional>
+
+class QLowEnergyController;
+class QLowEnergyService;
+class SensorInput;
+class SessionRecorder;
+class TelemetryPublisher;
+
+// ONE GATT SERVICE FED BY HALL SENSOR EDGES.  SUBCLASSES DESCRIBE THE CHARACTERISTICS,
+// TURN EDGES INTO COUNTERS AND ENCODE THE MEASUREMENT; THIS CLASS OWNS ONE QLowEnergyService
+// PER CONNECTED CENTRAL (EACH WITH ITS OWN SUBSCRIPTION STATE AND THE MEASUREMENT
+// CHARACTERISTIC HANDLE LOOKED UP ONCE PER ATTACH), THE NOTIFICATION SCHEDULER AND THE
+// NOTIFY.  A MEASUREMENT IS ENCODED ONCE AND THE SAME BYTES GO TO EVERY SUBSCRIBER.
+class MeasurementService
+{
+public:
+    struct FanOutCounters
+    {
+        // handed to the bluetooth stack for this central
+        quint64 sent = 0;
+        // subscribed, but the link was gone or the stack refused the notification
+        quint64 dropped = 0;
+        // from the end of encoding to the notification being handed over, in nanoseconds.  only
+        // measured once enableMetrics() was called
+        qint64 totalLatencyNanos = 0;
+        qint64 maxLatencyNanos = 0;
+    };
+
+    // HOT PATH INSTRUMENTATION, ALL OF IT ON THE QT THREAD.  NOTHING IS TIMED UNTIL
+    // enableMetrics(), SO A DAEMON WITHOUT A METRICS FILE PAYS NO EXTRA CLOCK READS.
+    struct Metrics
+    {
+        bool enabled = false;
+        quint64 edges = 0;
+        quint64 notifications = 0;
+        // handleEdge() per edge, timed by whoever dispatches the edges
+        Histogram edgeHandling;
+        // from the oldest edge in a notification to encoding it
+        Histogram edgeToNotify;
+        // one writeCharacteristic() call
+        Histogram notifyCall;
+        // notification timer firing after it was due
+        Histogram timerLateness;
+    };
+
+    // TAKES EVERY NOTIFICATION IN PLACE OF THE CONNECTED CENTRALS
+    typedef std::function<void(const QByteArray &value)> Sink;
+
+    virtual ~MeasurementService();
+
+    QBluetoothUuid uuid() const { return serviceUuid; }
+    // 16 BIT UUID OF THE NOTIFIED CHARACTERISTIC, AS IN SESSION RECORDINGS
+    quint16 measurementCharacteristic() const { return measurementUuid.toUInt16(); }
+    // SHORT NAME OF THE KIND OF SERVICE
+    virtual const char *name() const = 0;
+    // NAME OF THIS INSTANCE IN LOGS AND METRICS, SET BY WHOEVER HOSTS SEVERAL
+    const QString &label() const { return serviceLabel; }
+    void setLabel(const QString &label) { serviceLabel = label; }
+    // PINS WHOSE EDGES THIS SERVICE WANTS
+    virtual QList<int> pins() const = 0;
+    virtual void handleEdge(int pin, qint64 timestampNanos) = 0;
+    // CUMULATIVE COUNTS TO CARRY ON FROM, INDEXED BY PersistentCounters::Counter AS KEPT IN A
+    // STATE FILE (OR RECORDED FROM ONE).  SERVICES WITHOUT ANY IGNORE THEM
+    virtual void restoreCounters(const quint32 *) {}
+
+    // ADDS THE SERVICE TO THE CONTROLLER SERVING CENTRAL SLOT central, AGAIN AFTER EVERY
+    // DISCONNECT.  REPLACES WHATEVER WAS ATTACHED FOR THAT SLOT BEFORE.
+    bool attach(int central, QLowEnergyController *controller);
+    // FORGETS THE SERVICE AND SUBSCRIPTION OF A CENTRAL SLOT
+    void detach(int central);
+    // RUNS THE SERVICE WITHOUT AN ADAPTER (BENCHMARKS): WHILE SET, THE SINK COUNTS AS A
+    // SUBSCRIBED CENTRAL AND GETS EVERY NOTIFICATION INSTEAD OF THE REAL ONES
+    void setSink(const Sink &measurementSink) { sink = measurementSink; }
+    // EVERY NOTIFICATION PAYLOAD IS ALSO RECORDED THERE, NULL TURNS RECORDING OFF
+    void setRecorder(SessionRecorder *sessionRecorder) { recorder = sessionRecorder; }
+    // THE LATEST VALUES ALSO GO TO THIS STATION OF THE SHARED-MEMORY FEED AT EVERY REPORT.
+    // WHILE SET IT COUNTS AS A RECEIVER, SO LOCAL READERS SEE UPDATES WITHOUT A CENTRAL
+    void setTelemetry(TelemetryPublisher *publisher, int station);
+    // CALLED WITH THE SLOT OF A CENTRAL WHEN IT GETS ITS FIRST NOTIFICATION SINCE (RE)ATTACHING
+    void setFirstNotificationCallback(const std::function<void(int)> &callback) { firstNotification = callback; }
+    // CALLED WHENEVER A CENTRAL'S SUBSCRIPTION MAY HAVE CHANGED
+    void setSubscriptionCallback(const std::function<void()> &callback) { subscriptionCallback = callback; }
+    // CALL WHEN A CENTRAL CONNECTS OR DISCONNECTS, SINCE A BONDED CENTRAL MAY COME BACK ALREADY
+    // SUBSCRIBED.  RESTARTS NOTIFICATIONS FOR A NEW RECEIVER
+    void subscriptionsChanged();
+    // ANY SUBSCRIBED AND CONNECTED CENTRAL, A SINK OR THE TELEMETRY FEED
+    bool hasReceivers() const;
+    // CALLED BEFORE A TIMED NOTIFICATION SO IT SEES EVERY EDGE CAPTURED SO FAR
+    void setEdgeSource(const std::function<void()> &drainEdges) { scheduler.setBeforeTimedSend(drainEdges); }
+    void startReporting(const NotificationScheduler::Settings &settings) { scheduler.start(settings); }
+    // OFFLINE REPLAY, BEFORE startReporting(): NOTIFICATIONS ARE TIMED ON THE SENSOR CLOCK, AND
+    // WHOEVER MOVES THAT CLOCK CALLS runTimedSend() WHEN IT REACHES timedSendDueNanos() (-1: NONE)
+    void timeOnSensorClock();
+    qint64 timedSendDueNanos() const { return scheduler.dueNanos(); }
+    void runTimedSend() { scheduler.fireTimer(); }
+    void setConnectionInterval(int millis) { scheduler.setConnectionInterval(millis); }
+    const NotificationScheduler::Counters &notificationCounters() const { return scheduler.counters(); }
+    // ZERO FOR A SLOT THAT IS NOT ATTACHED
+    FanOutCounters fanOutCounters(int central) const;
+    void enableMetrics();
+    Metrics &metrics() { return serviceMetrics; }
+    const Metrics &metrics() const { return serviceMetrics; }
+
+protected:
+    MeasurementService(SensorInput &clock, const QBluetoothUuid &serviceUuid, const QBluetoothUuid &measurementUuid);
+
+    // ENCODES THE CURRENT MEASUREMENT AND HANDS IT TO sendMeasurement()
+    virtual void report() = 0;
+    // NEW SENSOR DATA FROM AN EDGE AT edgeNanos, THE SCHEDULER DECIDES WHEN IT GOES OUT
+    void measurementChanged(qint64 edgeNanos)
+    {
+        ++serviceMetrics.edges;
+        if (oldestUnsentEdge < 0)
+            oldestUnsentEdge = edgeNanos;
+        scheduler.dataChanged();
+    }
+    void sendMeasurement(const char *value, int size);
+    // REPORTS ONLY FILL IN TELEMETRY VALUES WHEN THIS IS TRUE
+    bool publishesTelemetry() const { return telemetry != nullptr; }
+    void publishTelemetry(const Telemetry::Values &values);
+    // TELEMETRY OF A BELT SENSOR FROM ITS SPEED IN 1/256 M/S AND TOTAL DISTANCE IN 1/10 M
+    static Telemetry::Values beltTelemetry(quint32 revolutions, qint64 lastEdgeNanos, int speed, int cadence,
+                                           int distancePerRevolution, quint32 totalDistance, qint64 nowNanos);
+
+    SensorInput &clock;
+    QLowEnergyServiceData serviceData;
+
+private:
+    struct Subscriber
+    {
+        int central;
+        QLowEnergyController *controller;
+        QScopedPointer<QLowEnergyService> service;
+        QLowEnergyCharacteristic measurementCharacteristic;
+        // NOTIFICATIONS ENABLED IN THIS CENTRAL'S CLIENT CHARACTERISTIC CONFIGURATION
+        bool subscribed = false;
+        bool firstNotificationPending = true;
+        FanOutCounters counters;
+    };
+
+    bool notify();
+    bool receiving(const Subscriber *subscriber) const;
+    int indexOf(int central) const;
+    static void readSubscription(Subscriber *subscriber);
+
+    const QBluetoothUuid serviceUuid;
+    const QBluetoothUuid measurementUuid;
+    QList<Subscriber *> subscribers;
+    std::function<void(int)> firstNotification;
+    std::function<void()> subscriptionCallback;
+    Sink sink;
+    SessionRecorder *recorder = nullptr;
+    TelemetryPublisher *telemetry = nullptr;
+    int telemetryStation = -1;
+    Metrics serviceMetrics;
+    QString serviceLabel;
+    // TIMESTAMP OF THE FIRST EDGE NOT YET IN A NOTIFICATION, -1 WHEN THERE IS NONE
+    qint64 oldestUnsentEdge = -1;
+    NotificationScheduler scheduler;
+
+    MeasurementService(const MeasurementService &) = delete;
+    MeasurementService &operator=(const MeasurementService &) = delete;
+};
+
+#endif // MEASUREMENTSERVICE_H
@@ -0,0 +1,108 @@
+#include "notificationscheduler.h"
+
+NotificationScheduler::NotificationScheduler(const Sender &send)
+    : send(send)
+{
+    timer.setSingleShot(true);
+    timer.setTimerType(Qt::PreciseTimer);
+    QObject::connect(&timer, &QTimer::timeout, [this]() { timerExpired(); });
+}
+
+void NotificationScheduler::start(const Settings &schedulerSettings)
+{
+    settings = schedulerSettings;
+    sinceLastSend.start();
+    if (manualClock)
+        lastSendNanos = manualClock();
+    timerClock.start();
+    startTimer(settings.keepAliveMillis);
+}
+
+void NotificationScheduler::dataChanged()
+{
+    if (pending)
+    {
+        currentCounters.coalesced += 1;
+        return;
+    }
+    const qint64 wait = minimumSpacing() - millisSinceLastSend();
+    if (wait <= 0)
+    {
+        sendNow();
+        return;
+    }
+    pending = true;
+    startTimer(int(wait));
+}
+
+void NotificationScheduler::resume()
+{
+    if (pending)
+        return;
+    pending = true;
+    startTimer(int(qMax<qint64>(0, minimumSpacing() - millisSinceLastSend())));
+}
+
+void NotificationScheduler::fireTimer()
+{
+    manualDue = -1;
+    timerExpired();
+}
+
+void NotificationScheduler::timerExpired()
+{
+    if (lateness)
+        lateness->record(timerClock.nsecsElapsed() - timerDueNanos);
+    const quint64 handled = currentCounters.sent + currentCounters.skipped;
+    if (beforeTimedSend)
+        beforeTimedSend();
+    // the drained edges may already have sent a notification
+    if (currentCounters.sent + currentCounters.skipped == handled)
+        sendNow();
+}
+
+void NotificationScheduler::sendNow()
+{
+    pending = false;
+    sinceLastSend.restart();
+    if (manualClock)
+        lastSendNanos = manualClock();
+    if (!send())
+    {
+        // NO KEEP-ALIVE WAKEUPS FOR NOBODY
+        currentCounters.skipped += 1;
+        stopTimer();
+        return;
+    }
+    currentCounters.sent += 1;
+    startTimer(settings.keepAliveMillis);
+}
+
+void NotificationScheduler::startTimer(int millis)
+{
+    if (manualClock)
+    {
+        manualDue = manualClock() + qint64(millis) * 1000000;
+        return;
+    }
+    if (lateness)
+        timerDueNanos = timerClock.nsecsElapsed() + qint64(millis) * 1000000;
+    timer.start(millis);
+}
+
+void NotificationScheduler::stopTimer()
+{
+    manualDue = -1;
+    timer.stop();
+}
+
+qint64 NotificationScheduler::millisSinceLastSend() const
+{
+    // WHOLE MILLISECONDS EITHER WAY, SO A REPLAY SPACES NOTIFICATIONS LIKE THE EVENT LOOP
+    return manualClock ? (manualClock() - lastSendNanos) / 1000000 : sinceLastSend.elapsed();
+}
+
+int NotificationScheduler::minimumSpacing() const
+{
+    return qMax(settings.coalesceWindowMillis, connectionInterval);
+}
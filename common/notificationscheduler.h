@@ -0,0 +1,89 @@
+#ifndef NOTIFICATIONSCHEDULER_H
+#define NOTIFICATIONSCHEDULER_H
+
+#include "histogram.h"
+
+#include <QtCore/qelapsedtimer.h>
+#include <QtCore/qtimer.h>
+#include <functional>
+
+// DECIDES WHEN A MEASUREMENT GOES OUT.  NEW SENSOR DATA IS SENT RIGHT AWAY WHEN THE LINK HAS
+// BEEN QUIET, OTHERWISE IT IS MERGED INTO ONE NOTIFICATION AT THE END OF THE COALESCING WINDOW
+// (NEVER CLOSER THAN ONE CONNECTION INTERVAL TO THE PREVIOUS ONE).  WITHOUT NEW DATA A
+// KEEP-ALIVE NOTIFICATION REPEATS THE LAST VALUES SO CLIENTS CAN TELL THE SENSOR IS STILL THERE.
+// WHILE NOBODY RECEIVES THEM THE KEEP-ALIVES STOP, UNTIL NEW DATA OR resume().
+//
+// AN OFFLINE REPLAY GIVES IT A MANUAL CLOCK: TIME THEN ONLY MOVES WITH THAT CLOCK, AND A DUE
+// TIMER FIRES WHEN THE REPLAY CALLS fireTimer() INSTEAD OF FROM THE EVENT LOOP.
+class NotificationScheduler
+{
+public:
+    // THE DAEMON'S DEFAULTS
+    struct Settings
+    {
+        // NEW DATA ARRIVING WITHIN THIS MANY MILLISECONDS OF A NOTIFICATION IS MERGED INTO THE NEXT ONE
+        int coalesceWindowMillis = 50;
+        // NOTIFICATION PERIOD IN MILLISECONDS WHEN NOTHING CHANGES
+        int keepAliveMillis = 1000;
+    };
+    struct Counters
+    {
+        // handed to the bluetooth stack
+        quint64 sent = 0;
+        // new data merged into a notification that was already pending
+        quint64 coalesced = 0;
+        // due, but dropped because no central was there to receive it
+        quint64 skipped = 0;
+    };
+    // RETURNS FALSE WHEN THE NOTIFICATION WAS SKIPPED
+    typedef std::function<bool()> Sender;
+
+    typedef std::function<qint64()> Clock;
+
+    explicit NotificationScheduler(const Sender &send);
+
+    // SET BEFORE start().  NANOSECONDS, ANY ORIGIN
+    void setManualClock(const Clock &now) { manualClock = now; }
+    void start(const Settings &settings);
+    // NEGOTIATED BLE CONNECTION INTERVAL, 0 WHILE UNKNOWN
+    void setConnectionInterval(int millis) { connectionInterval = millis; }
+    // CALLED BEFORE A TIMED NOTIFICATION SO IT SEES EVERY EDGE CAPTURED SO FAR
+    void setBeforeTimedSend(const std::function<void()> &callback) { beforeTimedSend = callback; }
+    void dataChanged();
+    // SOMEONE STARTED LISTENING: SENDS THE CURRENT VALUES AS SOON AS THE SPACING ALLOWS AND
+    // RESTARTS THE KEEP-ALIVES
+    void resume();
+    const Counters &counters() const { return currentCounters; }
+    // HOW LATE THE TIMER FIRES AGAINST WHEN IT WAS DUE, NULL (THE DEFAULT) RECORDS NOTHING
+    void setLatenessHistogram(Histogram *histogram) { lateness = histogram; }
+    // MANUAL CLOCK ONLY: WHEN THE TIMER IS DUE, -1 WHILE IT IS STOPPED
+    qint64 dueNanos() const { return manualDue; }
+    // MANUAL CLOCK ONLY: RUNS THE DUE TIMER, WITH THE CLOCK AT ITS DUE TIME
+    void fireTimer();
+
+private:
+    void timerExpired();
+    void sendNow();
+    void startTimer(int millis);
+    void stopTimer();
+    qint64 millisSinceLastSend() const;
+    int minimumSpacing() const;
+
+    const Sender send;
+    std::function<void()> beforeTimedSend;
+    Settings settings;
+    int connectionInterval = 0;
+    bool pending = false;
+    QTimer timer;
+    QElapsedTimer sinceLastSend;
+    Counters currentCounters;
+    Histogram *lateness = nullptr;
+    Clock manualClock;
+    qint64 manualDue = -1;
+    qint64 lastSendNanos = 0;
+    // MONOTONIC TIME THE TIMER IS DUE, ONLY KEPT WHILE A HISTOGRAM IS SET
+    QElapsedTimer timerClock;
+    qint64 timerDueNanos = 0;
+};
+
+#endif // NOTIFICATIONSCHEDULER_H
@@ -0,0 +1,254 @@
+#include "peripheral.h"
+#include "measurementservice.h"
+
+#include <QtBluetooth/qbluetoothlocaldevice.h>
+#include <QtBluetooth/qlowenergyadvertisingparameters.h>
+#include <QtBluetooth/qlowenergyconnectionparameters.h>
+#include <QtBluetooth/qlowenergycontroller.h>
+#include <QtCore/qloggingcategory.h>
+
+namespace
+{
+const int OPEN_SLOT_RETRY_INTERVAL = 1000;
+}
+
+Peripheral::Peripheral(const Settings &settings, const QList<MeasurementService *> &services)
+    : settings(settings), hosted(services)
+{
+    // SET UP ADVERTISING FOR EVERY HOSTED SERVICE, EACH KIND ONCE SO SEVERAL STATIONS STILL FIT
+    // THE 31 BYTE ADVERTISEMENT
+    QList<QBluetoothUuid> uuids;
+    for (MeasurementService *service : hosted)
+    {
+        if (!uuids.contains(service->uuid()))
+            uuids << service->uuid();
+        service->setFirstNotificationCallback([this](int slot) { firstNotificationSent(slot); });
+    }
+    advertisingData.setDiscoverability(QLowEnergyAdvertisingData::DiscoverabilityGeneral);
+    advertisingData.setIncludePowerLevel(true);
+    advertisingData.setLocalName(settings.name);
+    advertisingData.setServices(uuids);
+
+    centrals.fill(nullptr, settings.maxCentrals);
+    connectionIntervals.fill(0, settings.maxCentrals);
+    reconnectClocks.fill(ReconnectClock(), settings.maxCentrals);
+    retryTimer.setSingleShot(true);
+    retryTimer.setInterval(OPEN_SLOT_RETRY_INTERVAL);
+    QObject::connect(&retryTimer, &QTimer::timeout, [this]() {
+        if (advertisingSlot < 0)
+            openSlot();
+    });
+}
+
+Peripheral::~Peripheral()
+{
+    qDeleteAll(centrals);
+}
+
+void Peripheral::start()
+{
+    openSlot();
+}
+
+bool Peripheral::canSelectAdapter()
+{
+#if QT_VERSION >= QT_VERSION_CHECK(6, 2, 0)
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool Peripheral::adapterExists(const QBluetoothAddress &address)
+{
+    for (const QBluetoothHostInfo &adapter : QBluetoothLocalDevice::allDevices())
+    {
+        if (adapter.address() == address)
+            return true;
+    }
+    return false;
+}
+
+QLowEnergyController *Peripheral::createController() const
+{
+#if QT_VERSION >= QT_VERSION_CHECK(6, 2, 0)
+    if (!settings.adapter.isNull())
+        return QLowEnergyController::createPeripheral(settings.adapter);
+#endif
+    return QLowEnergyController::createPeripheral();
+}
+
+void Peripheral::openSlot()
+{
+    const int slot = centrals.indexOf(nullptr);
+    if (slot < 0)
+        return;
+    QLowEnergyController *controller = createController();
+    centrals[slot] = controller;
+    QObject::connect(controller, &QLowEnergyController::connected, [this, slot]() { centralConnected(slot); });
+    QObject::connect(controller, &QLowEnergyController::disconnected, [this, slot]() { centralDisconnected(slot); });
+    QObject::connect(controller, &QLowEnergyController::stateChanged, [this, slot](QLowEnergyController::ControllerState state) {
+        if (state == QLowEnergyController::AdvertisingState)
+            advertisingStarted(slot);
+    });
+    // NOTIFICATIONS ARE NEVER SPACED CLOSER THAN THE NEGOTIATED CONNECTION INTERVAL
+    QObject::connect(controller, &QLowEnergyController::connectionUpdated, [this, slot](const QLowEnergyConnectionParameters &parameters) {
+        connectionIntervals[slot] = int(parameters.maximumInterval());
+        updateConnectionInterval();
+    });
+    if (!attachAndAdvertise(slot))
+    {
+        freeSlot(slot);
+        retryTimer.start();
+    }
+}
+
+bool Peripheral::attachAndAdvertise(int slot)
+{
+    bool attached = true;
+    for (MeasurementService *service : hosted)
+        attached = service->attach(slot, centrals.at(slot)) && attached;
+    if (!attached)
+    {
+        qWarning() << settings.name << "cannot add the GATT services for central" << slot;
+        return false;
+    }
+    centrals.at(slot)->startAdvertising(QLowEnergyAdvertisingParameters(),
+                                        advertisingData, advertisingData);
+    advertisingSlot = slot;
+    return true;
+}
+
+void Peripheral::freeSlot(int slot)
+{
+    for (MeasurementService *service : hosted)
+        service->detach(slot);
+    // IT MAY STILL BE INSIDE ITS OWN SIGNAL, SO IT CAN ONLY BE DELETED LATER
+    centrals.at(slot)->deleteLater();
+    centrals[slot] = nullptr;
+}
+
+void Peripheral::centralConnected(int slot)
+{
+    qInfo() << settings.name << "central" << slot << "connected" << centrals.at(slot)->remoteAddress().toString();
+    if (advertisingSlot == slot)
+        advertisingSlot = -1;
+    ReconnectClock &clock = reconnectClocks[slot];
+    clock.sinceConnect.start();
+    clock.awaitingNotification = true;
+    // KEEP ADVERTISING FOR THE NEXT CENTRAL WHILE THERE IS ROOM
+    if (advertisingSlot < 0)
+        openSlot();
+    for (MeasurementService *service : hosted)
+        service->subscriptionsChanged();
+}
+
+void Peripheral::centralDisconnected(int slot)
+{
+    ReconnectClock &clock = reconnectClocks[slot];
+    clock.sinceDisconnect.start();
+    clock.awaitingNotification = false;
+
+    reportFanOut(slot);
+
+    // REUSE THIS CONTROLLER WHEN NOBODY ELSE IS ADVERTISING, OTHERWISE FREE THE SLOT.
+    // ADVERTISING COMES FIRST, EVERYTHING ELSE CAN WAIT FOR THE NEXT CENTRAL.  BLUEZ DROPS
+    // THE ADDED SERVICES WITH THE LINK, SO THEY ARE ALWAYS ADDED AGAIN
+    if (advertisingSlot < 0)
+    {
+        clock.awaitingAdvertising = true;
+        if (!attachAndAdvertise(slot))
+        {
+            // A CONTROLLER THAT CANNOT TAKE THE SERVICES AGAIN IS REPLACED BY A FRESH ONE
+            clock.awaitingAdvertising = false;
+            freeSlot(slot);
+            openSlot();
+        }
+    }
+    else
+    {
+        freeSlot(slot);
+    }
+    connectionIntervals[slot] = 0;
+    updateConnectionInterval();
+    for (MeasurementService *service : hosted)
+        service->subscriptionsChanged();
+}
+
+void Peripheral::advertisingStarted(int slot)
+{
+    ReconnectClock &clock = reconnectClocks[slot];
+    if (!clock.awaitingAdvertising)
+        return;
+    clock.awaitingAdvertising = false;
+    const qint64 nanos = clock.sinceDisconnect.nsecsElapsed();
+    disconnectToAdvertising.add(nanos);
+    qInfo() << settings.name << "central" << slot << "advertising again" << nanos / 1000 << "us after disconnect";
+}
+
+void Peripheral::firstNotificationSent(int slot)
+{
+    ReconnectClock &clock = reconnectClocks[slot];
+    if (!clock.awaitingNotification)
+        return;
+    clock.awaitingNotification = false;
+    const qint64 nanos = clock.sinceConnect.nsecsElapsed();
+    connectToNotification.add(nanos);
+    qInfo() << settings.name << "central" << slot << "first notification" << nanos / 1000000 << "ms after connect";
+}
+
+void Peripheral::Latency::add(qint64 nanos)
+{
+    ++count;
+    totalNanos += nanos;
+    maxNanos = qMax(maxNanos, nanos);
+}
+
+void Peripheral::updateConnectionInterval()
+{
+    // THE SLOWEST LINK DECIDES, SO NO CENTRAL GETS NOTIFICATIONS QUEUED FASTER THAN IT CAN TAKE THEM
+    int interval = 0;
+    for (int slotInterval : connectionIntervals)
+        interval = qMax(interval, slotInterval);
+    for (MeasurementService *service : hosted)
+        service->setConnectionInterval(interval);
+}
+
+void Peripheral::reportStats() const
+{
+    for (int slot = 0; slot < centrals.size(); ++slot)
+    {
+        if (centrals.at(slot) && slot != advertisingSlot)
+            reportFanOut(slot);
+    }
+    if (disconnectToAdvertising.count)
+    {
+        qInfo().nospace() << settings.name << " reconnects: " << disconnectToAdvertising.count << ", disconnect to advertising mean "
+                          << disconnectToAdvertising.totalNanos / qint64(disconnectToAdvertising.count) / 1000
+                          << " us max " << disconnectToAdvertising.maxNanos / 1000 << " us";
+    }
+    if (connectToNotification.count)
+    {
+        qInfo().nospace() << settings.name << " connects: " << connectToNotification.count << ", connect to first notification mean "
+                          << connectToNotification.totalNanos / qint64(connectToNotification.count) / 1000000
+                          << " ms max " << connectToNotification.maxNanos / 1000000 << " ms";
+    }
+}
+
+void Peripheral::reportFanOut(int slot) const
+{
+    for (const MeasurementService *service : hosted)
+    {
+        const MeasurementService::FanOutCounters counters = service->fanOutCounters(slot);
+        if (!service->metrics().enabled)
+        {
+            qInfo().nospace() << service->label() << " central " << slot << ": " << counters.sent << " sent, "
+                              << counters.dropped << " dropped";
+            continue;
+        }
+        qInfo().nospace() << service->label() << " central " << slot << ": " << counters.sent << " sent, "
+                          << counters.dropped << " dropped, fan-out latency mean "
+                          << (counters.sent ? counters.totalLatencyNanos / qint64(counters.sent) / 1000 : 0)
+                          << " us max " << counters.maxLatencyNanos / 1000 << " us";
+    }
+}
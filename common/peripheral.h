@@ -0,0 +1,107 @@
+#ifndef PERIPHERAL_H
+#define PERIPHERAL_H
+
+#include <QtBluetooth/qbluetoothaddress.h>
+#include <QtBluetooth/qlowenergyadvertisingdata.h>
+#include <QtCore/qelapsedtimer.h>
+#include <QtCore/qlist.h>
+#include <QtCore/qstring.h>
+#include <QtCore/qtimer.h>
+#include <QtCore/qvector.h>
+
+class MeasurementService;
+class QLowEnergyController;
+
+// ONE ADVERTISED PERIPHERAL: A LOCAL NAME ON ONE BLUETOOTH ADAPTER WITH ITS OWN GATT DATABASE
+// (THE SERVICES HANDED TO IT), ITS OWN CENTRALS AND ITS OWN NOTIFICATION TRAFFIC.  THE DAEMON
+// RUNS ONE PER ADAPTER; ALL OF THEM SHARE THE DAEMON'S EDGE CAPTURE.
+//
+// QT'S PERIPHERAL CONTROLLER SERVES ONE LINK, SO EVERY CENTRAL SLOT GETS ITS OWN CONTROLLER:
+// WHEN A CENTRAL CONNECTS AND A SLOT IS STILL FREE, A FRESH CONTROLLER STARTS ADVERTISING
+// FOR THE NEXT ONE (A WATCH AND A TABLET APP, SAY).
+//
+// THE GATT SERVICES ARE NOT KEPT ACROSS A RECONNECT: BLUEZ REMOVES A CONTROLLER'S SERVICES
+// WHEN ITS LINK GOES, SO A DISCONNECT ADDS THEM AGAIN BEFORE ADVERTISING.  ONLY THE
+// MEASUREMENT STATE, WHICH LIVES IN THE MeasurementServices, CARRIES OVER.
+class Peripheral
+{
+public:
+    struct Settings
+    {
+        // ADVERTISED LOCAL NAME
+        QString name;
+        // LOCAL ADAPTER TO ADVERTISE ON, NULL FOR THE DEFAULT ONE
+        QBluetoothAddress adapter;
+        // CENTRALS THAT CAN BE CONNECTED AND SUBSCRIBED AT THE SAME TIME
+        int maxCentrals = 1;
+    };
+
+    // THE SERVICES STAY THE CALLER'S.  DELETE THEM FIRST: THEIR QLowEnergyServices BELONG TO
+    // THIS PERIPHERAL'S CONTROLLERS
+    Peripheral(const Settings &settings, const QList<MeasurementService *> &services);
+    ~Peripheral();
+
+    void start();
+    const QString &name() const { return settings.name; }
+    const QList<MeasurementService *> &services() const { return hosted; }
+    int centralSlots() const { return settings.maxCentrals; }
+    void reportStats() const;
+
+    // QT BEFORE 6.2 CAN ONLY CREATE A PERIPHERAL ON THE DEFAULT ADAPTER
+    static bool canSelectAdapter();
+    // FALSE WHEN NO LOCAL ADAPTER HAS THIS ADDRESS
+    static bool adapterExists(const QBluetoothAddress &address);
+
+private:
+    // RECONNECT TIMING OF ONE CENTRAL SLOT
+    struct ReconnectClock
+    {
+        QElapsedTimer sinceDisconnect;
+        QElapsedTimer sinceConnect;
+        bool awaitingAdvertising = false;
+        bool awaitingNotification = false;
+    };
+    struct Latency
+    {
+        quint64 count = 0;
+        qint64 totalNanos = 0;
+        qint64 maxNanos = 0;
+
+        void add(qint64 nanos);
+    };
+
+    QLowEnergyController *createController() const;
+    // STARTS ADVERTISING ON A NEW CONTROLLER IN THE FIRST FREE CENTRAL SLOT, AND TRIES AGAIN
+    // LATER WHEN THE CONTROLLER CANNOT TAKE THE SERVICES
+    void openSlot();
+    // FALSE WHEN A SERVICE COULD NOT BE ADDED, NOTHING IS ADVERTISED THEN
+    bool attachAndAdvertise(int slot);
+    void freeSlot(int slot);
+    void centralConnected(int slot);
+    void centralDisconnected(int slot);
+    void advertisingStarted(int slot);
+    void firstNotificationSent(int slot);
+    void updateConnectionInterval();
+    void reportFanOut(int slot) const;
+
+    const Settings settings;
+    const QList<MeasurementService *> hosted;
+    QLowEnergyAdvertisingData advertisingData;
+    // ONE PERIPHERAL CONTROLLER PER CENTRAL SLOT, NULL WHILE THE SLOT IS FREE
+    QVector<QLowEnergyController *> centrals;
+    // NEGOTIATED CONNECTION INTERVAL OF EACH SLOT IN MILLISECONDS, 0 WHILE UNKNOWN
+    QVector<int> connectionIntervals;
+    // SLOT WHOSE CONTROLLER IS WAITING FOR A CENTRAL, -1 WHEN ALL SLOTS ARE TAKEN
+    int advertisingSlot = -1;
+    QVector<ReconnectClock> reconnectClocks;
+    // OPENS A SLOT AGAIN AFTER A CONTROLLER FAILED, SO THE PERIPHERAL NEVER STAYS HIDDEN
+    QTimer retryTimer;
+    // FROM DISCONNECT TO ADVERTISING AGAIN, AND FROM CONNECT TO THE FIRST NOTIFICATION
+    Latency disconnectToAdvertising;
+    Latency connectToNotification;
+
+    Peripheral(const Peripheral &) = delete;
+    Peripheral &operator=(const Peripheral &) = delete;
+};
+
+#endif // PERIPHERAL_H
@@ -0,0 +1,214 @@
+#include "persistentcounters.h"
+
+#include <QtCore/qloggingcategory.h>
+#include <cstddef>
+#include <cstring>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+// IDENTIFIES THE FILE AND THE LAYOUT BELOW, BUMP IT WHEN THE LAYOUT CHANGES
+const quint32 MAGIC = 0x53544101;
+}
+
+// EACH RECORD SITS IN ITS OWN 64 BYTE LINE, FAR BELOW THE 512 BYTE SECTOR A DISK WRITES AT ONCE
+struct PersistentCounters::File
+{
+    quint32 magic;
+    // NUL TERMINATED, EMPTY IN FILES WRITTEN BEFORE IT WAS KEPT
+    char identity[IDENTITY_SIZE];
+    char headerPadding[60 - IDENTITY_SIZE];
+    Record live;
+    char livePadding[64 - sizeof(Record)];
+    struct Slot
+    {
+        Record record;
+        char padding[64 - sizeof(Record)];
+    } checkpoints[2];
+};
+
+PersistentCounters::PersistentCounters(const QString &path, const QByteArray &identity)
+    : path(path), identity(identity.left(IDENTITY_SIZE - 1))
+{
+}
+
+PersistentCounters::~PersistentCounters()
+{
+    if (!file)
+        return;
+    checkpoint();
+    {
+        std::lock_guard<std::mutex> lock(syncMutex);
+        stopping = true;
+    }
+    syncWanted.notify_one();
+    syncThread.join();
+    munmap(file, sizeof(File));
+    ::close(fd);
+}
+
+bool PersistentCounters::open()
+{
+    static_assert(sizeof(Record) <= 64, "a record must fit its line");
+    static_assert(IDENTITY_SIZE <= 60, "the identity must fit the header line");
+    fd = ::open(path.toLocal8Bit().constData(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+        qWarning() << "cannot open state file" << path << strerror(errno);
+        return false;
+    }
+    // ONLY A NEW OR EMPTY FILE IS LAID OUT HERE.  ANYTHING ELSE MUST ALREADY BE A STATE FILE, SO
+    // A MISTYPED --state-file NEVER TRUNCATES OR OVERWRITES AN UNRELATED FILE
+    struct stat info;
+    if (fstat(fd, &info) != 0)
+    {
+        qWarning() << "cannot open state file" << path << strerror(errno);
+        ::close(fd);
+        fd = -1;
+        return false;
+    }
+    const bool created = info.st_size == 0;
+    if (!created && info.st_size < off_t(sizeof(File)))
+    {
+        qWarning() << "not a state file, left alone:" << path;
+        ::close(fd);
+        fd = -1;
+        return false;
+    }
+    if ((created && ftruncate(fd, sizeof(File)) != 0)
+        || (file = static_cast<File *>(mmap(nullptr, sizeof(File), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0))) == MAP_FAILED)
+    {
+        qWarning() << "cannot map state file" << path << strerror(errno);
+        file = nullptr;
+        ::close(fd);
+        fd = -1;
+        return false;
+    }
+    if (!created && file->magic != MAGIC)
+    {
+        qWarning() << "not a state file, left alone:" << path;
+        munmap(file, sizeof(File));
+        file = nullptr;
+        ::close(fd);
+        fd = -1;
+        return false;
+    }
+    // COUNTS OF ANOTHER SENSOR WOULD CARRY ON AS THIS ONE'S, SO THEY ARE NOT USED EITHER
+    const QByteArray fileIdentity(file->identity, int(qstrnlen(file->identity, IDENTITY_SIZE)));
+    if (!created && !fileIdentity.isEmpty() && fileIdentity != identity)
+    {
+        qWarning() << "state file" << path << "keeps the counters of" << fileIdentity << "not" << identity << ", left alone";
+        munmap(file, sizeof(File));
+        file = nullptr;
+        ::close(fd);
+        fd = -1;
+        return false;
+    }
+    memset(file->identity, 0, IDENTITY_SIZE);
+    memcpy(file->identity, identity.constData(), size_t(identity.size()));
+
+    // THE NEWEST INTACT RECORD WINS, A FRESH FILE (OR ONE WITH EVERY RECORD TORN) STARTS FROM 0
+    const Record *newest = nullptr;
+    if (!created)
+    {
+        const Record *candidates[] = { &file->live, &file->checkpoints[0].record, &file->checkpoints[1].record };
+        for (const Record *candidate : candidates)
+        {
+            if (valid(*candidate) && (!newest || candidate->sequence > newest->sequence))
+                newest = candidate;
+        }
+    }
+    if (newest)
+    {
+        if (newest != &file->live)
+            file->live = *newest;
+        sequence = newest->sequence;
+        qInfo() << "counters restored from" << path;
+    }
+    else
+    {
+        memset(&file->live, 0, sizeof(File) - offsetof(File, live));
+        file->magic = MAGIC;
+        commit();
+    }
+    checkpointedSequence = sequence;
+    nextSlot = file->checkpoints[0].record.sequence <= file->checkpoints[1].record.sequence ? 0 : 1;
+
+    syncThread = std::thread([this]() { syncLoop(); });
+    return true;
+}
+
+quint32 PersistentCounters::value(Counter counter) const
+{
+    return file ? file->live.values[counter] : 0;
+}
+
+const quint32 *PersistentCounters::values() const
+{
+    return file->live.values;
+}
+
+PersistentCounters::Record &PersistentCounters::live()
+{
+    return file->live;
+}
+
+void PersistentCounters::commit()
+{
+    Record &record = file->live;
+    record.sequence = ++sequence;
+    record.checksum = checksum(record);
+}
+
+void PersistentCounters::checkpoint()
+{
+    // NOTHING NEW, SO NO WRITE TO WEAR THE SD CARD
+    if (!file || sequence == checkpointedSequence)
+        return;
+    // THE OTHER SLOT STAYS INTACT WHILE THIS ONE IS WRITTEN
+    file->checkpoints[nextSlot].record = file->live;
+    nextSlot ^= 1;
+    checkpointedSequence = sequence;
+    {
+        std::lock_guard<std::mutex> lock(syncMutex);
+        syncPending = true;
+    }
+    syncWanted.notify_one();
+}
+
+void PersistentCounters::startCheckpoints(int intervalMillis)
+{
+    QObject::connect(&checkpointTimer, &QTimer::timeout, [this]() { checkpoint(); });
+    checkpointTimer.start(intervalMillis);
+}
+
+void PersistentCounters::syncLoop()
+{
+    std::unique_lock<std::mutex> lock(syncMutex);
+    for (;;)
+    {
+        syncWanted.wait(lock, [this]() { return syncPending || stopping; });
+        if (!syncPending && stopping)
+            return;
+        syncPending = false;
+        // WRITING BACK TO AN SD CARD CAN TAKE TENS OF MILLISECONDS, NOT ON THE QT THREAD
+        lock.unlock();
+        if (msync(file, sizeof(File), MS_SYNC) != 0)
+            qWarning() << "cannot sync state file" << path << strerror(errno);
+        lock.lock();
+    }
+}
+
+quint32 PersistentCounters::checksum(const Record &record)
+{
+    // FNV-1a OVER THE SEQUENCE AND THE VALUES
+    quint32 hash = 2166136261u;
+    const unsigned char *bytes = reinterpret_cast<const unsigned char *>(&record);
+    for (size_t i = 0; i < offsetof(Record, checksum); ++i)
+        hash = (hash ^ bytes[i]) * 16777619u;
+    return hash;
+}
@@ -0,0 +1,93 @@
+#ifndef PERSISTENTCOUNTERS_H
+#define PERSISTENTCOUNTERS_H
+
+#include <QtCore/qbytearray.h>
+#include <QtCore/qstring.h>
+#include <QtCore/qtimer.h>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// CUMULATIVE COUNTERS AND LAST EVENT TIMES KEPT IN A SMALL MEMORY-MAPPED STATE FILE SO A
+// RESTARTED DAEMON CARRIES ON COUNTING INSTEAD OF GOING BACK TO 0.
+//
+// EVERY UPDATE IS A FEW PLAIN STORES INTO THE LIVE RECORD OF THE MAPPING PLUS A CHECKSUM,
+// NO SYSTEM CALL, AND THE PAGE CACHE KEEPS IT WHEN THE PROCESS DIES.  FOR A POWER CUT THE
+// LIVE RECORD IS COPIED INTO ONE OF TWO CHECKPOINT SLOTS IN TURN AND SYNCED TO DISK FROM A
+// BACKGROUND THREAD.  ON OPEN THE NEWEST RECORD WHOSE CHECKSUM MATCHES WINS, SO A TORN
+// WRITE ONLY EVER COSTS THE UPDATES SINCE THE PREVIOUS CHECKPOINT.
+//
+// ALL METHODS EXCEPT THE SYNC ITSELF RUN ON THE QT THREAD.
+class PersistentCounters
+{
+public:
+    enum Counter
+    {
+        WheelRevolutions,
+        LastWheelEventTime,
+        CrankRevolutions,
+        LastCrankEventTime,
+        TotalDistance,
+        DistanceRemainder,
+        COUNTER_COUNT = 8
+    };
+    enum
+    {
+        IDENTITY_SIZE = 32
+    };
+
+    // identity NAMES THE SENSOR THE COUNTS BELONG TO (E.G. "speed-cadence:17:27"), AT MOST
+    // IDENTITY_SIZE - 1 CHARACTERS
+    PersistentCounters(const QString &path, const QByteArray &identity);
+    ~PersistentCounters();
+
+    // MAPS THE FILE, CREATING IT IF NEEDED, AND LOADS THE NEWEST VALID RECORD.  FALSE, AND THE
+    // FILE UNTOUCHED, WHEN IT IS NOT EMPTY AND NOT A STATE FILE, OR KEEPS ANOTHER SENSOR'S COUNTS
+    bool open();
+    bool isOpen() const { return file != nullptr; }
+    quint32 value(Counter counter) const;
+    // ALL COUNTER_COUNT VALUES, INDEXED BY Counter
+    const quint32 *values() const;
+
+    // HOT PATH: ANY NUMBER OF set() CALLS FOLLOWED BY ONE commit()
+    void set(Counter counter, quint32 value) { live().values[counter] = value; }
+    void commit();
+
+    // COPIES THE LIVE RECORD INTO A CHECKPOINT SLOT AND HAS IT SYNCED, IF ANYTHING CHANGED
+    void checkpoint();
+    void startCheckpoints(int intervalMillis);
+
+private:
+    struct Record
+    {
+        quint32 sequence;
+        quint32 values[COUNTER_COUNT];
+        quint32 checksum;
+    };
+    struct File;
+
+    Record &live();
+    static quint32 checksum(const Record &record);
+    static bool valid(const Record &record) { return record.checksum == checksum(record); }
+    void syncLoop();
+
+    const QString path;
+    const QByteArray identity;
+    int fd = -1;
+    File *file = nullptr;
+    quint32 sequence = 0;
+    quint32 checkpointedSequence = 0;
+    int nextSlot = 0;
+    QTimer checkpointTimer;
+
+    std::thread syncThread;
+    std::mutex syncMutex;
+    std::condition_variable syncWanted;
+    bool syncPending = false;
+    bool stopping = false;
+
+    PersistentCounters(const PersistentCounters &) = delete;
+    PersistentCounters &operator=(const PersistentCounters &) = delete;
+};
+
+#endif // PERSISTENTCOUNTERS_H
@@ -0,0 +1,139 @@
+#include "rscservice.h"
+#include "persistentcounters.h"
+#include "sensorinput.h"
+
+#include <QtBluetooth/qlowenergycharacteristic.h>
+#include <QtBluetooth/qlowenergycharacteristicdata.h>
+#include <QtBluetooth/qlowenergydescriptordata.h>
+
+namespace
+{
+typedef RscMeasurementEncoder<RscMeasurement::TotalDistancePresent> MeasuredEncoder;
+typedef RscMeasurementEncoder<RscMeasurement::InstantaneousStrideLengthPresent | RscMeasurement::TotalDistancePresent> EstimatedEncoder;
+
+// THE BELT SENSOR CANNOT SEE FOOTSTRIKES.  ONLY WHEN ASKED FOR, CADENCE IS ESTIMATED FROM A
+// TYPICAL SPEED TO CADENCE CURVE.  SPEED IN 1/256 M/S, CADENCE IN STEPS PER MINUTE,
+// INTERPOLATED LINEARLY BETWEEN POINTS
+struct CadencePoint
+{
+    int speed;
+    int cadence;
+};
+const CadencePoint CADENCE_CURVE[] = {
+    { 64, 70 },    // 0.25 m/s shuffling
+    { 358, 110 },  // 1.4 m/s walking
+    { 563, 150 },  // 2.2 m/s walk to run transition
+    { 768, 165 },  // 3.0 m/s
+    { 1024, 172 }, // 4.0 m/s
+    { 1280, 180 }, // 5.0 m/s
+    { 1536, 188 }  // 6.0 m/s
+};
+const int CADENCE_POINTS = sizeof(CADENCE_CURVE) / sizeof(CADENCE_CURVE[0]);
+// ABOVE THIS SPEED (1/256 M/S) THE STATUS BIT SAYS RUNNING
+const int RUNNING_SPEED = 563;
+
+int cadenceAt(int speed)
+{
+    if (speed < CADENCE_CURVE[0].speed)
+        return 0;
+    for (int i = 1; i < CADENCE_POINTS; ++i)
+    {
+        const CadencePoint &from = CADENCE_CURVE[i - 1];
+        const CadencePoint &to = CADENCE_CURVE[i];
+        if (speed < to.speed)
+            return from.cadence + (to.cadence - from.cadence) * (speed - from.speed) / (to.speed - from.speed);
+    }
+    return CADENCE_CURVE[CADENCE_POINTS - 1].cadence;
+}
+}
+
+RscService::RscService(SensorInput &clock, int beltPin, int distancePerRevolution, const SpeedEstimator::Settings &speedSettings,
+                       bool estimateCadence, PersistentCounters *counters)
+    : MeasurementService(clock, QBluetoothUuid::RunningSpeedAndCadence, QBluetoothUuid::RSCMeasurement),
+      beltPin(beltPin), distancePerRevolution(distancePerRevolution), speedEstimator(distancePerRevolution, speedSettings),
+      estimateCadence(estimateCadence), encoder(estimateCadence ? &EstimatedEncoder::encode : &MeasuredEncoder::encode),
+      counters(counters)
+{
+    measurement.instantaneousSpeed = 0;
+    measurement.instantaneousCadence = 0;
+    measurement.instantaneousStrideLength = 0;
+    measurement.totalDistance = 0;
+    measurement.running = false;
+    if (counters)
+        restoreCounters(counters->values());
+
+    // SET UP CHARACTERISTIC DATA FOR SPEED MEASUREMENT
+    QLowEnergyCharacteristicData rscMeasurementData;
+    rscMeasurementData.setUuid(QBluetoothUuid::RSCMeasurement);
+    rscMeasurementData.setValue(QByteArray(estimateCadence ? int(EstimatedEncoder::Size) : int(MeasuredEncoder::Size), 0));
+    rscMeasurementData.setProperties(QLowEnergyCharacteristic::Notify);
+    const QLowEnergyDescriptorData clientConfig(QBluetoothUuid::ClientCharacteristicConfiguration,
+                                              QByteArray(2, 0));
+    rscMeasurementData.addDescriptor(clientConfig);
+
+    // SET UP CHARACTERISTIC DATA FOR WEEL REVOLUTION DATA
+    QLowEnergyCharacteristicData rscDescriptionData;
+    rscDescriptionData.setUuid(QBluetoothUuid::RSCFeature);
+    // uint16 bit field: total distance and walking or running status supported, stride length
+    // only when it is estimated
+    QByteArray rscDescriptionBytes(2, 0);
+    MeasurementEncoding::putUInt16(rscDescriptionBytes.data(),
+                                   (estimateCadence ? RscMeasurement::InstantaneousStrideLengthSupported : 0)
+                                       | RscMeasurement::TotalDistanceSupported
+                                       | RscMeasurement::WalkingOrRunningStatusSupported);
+    rscDescriptionData.setValue(rscDescriptionBytes);
+    rscDescriptionData.setProperties(QLowEnergyCharacteristic::Read);
+
+    // NOW COLLECT ALL CHARACTERISTICS AND ATTACH TO SERVICE
+    serviceData.addCharacteristic(rscMeasurementData);
+    serviceData.addCharacteristic(rscDescriptionData);
+}
+
+void RscService::restoreCounters(const quint32 *values)
+{
+    measurement.totalDistance = values[PersistentCounters::TotalDistance];
+    distanceRemainder = int(values[PersistentCounters::DistanceRemainder]);
+}
+
+QList<int> RscService::pins() const
+{
+    return QList<int>() << beltPin;
+}
+
+void RscService::handleEdge(int, qint64 timestampNanos)
+{
+    speedEstimator.addEdge(timestampNanos);
+    beltRevolutions += 1;
+    lastEdgeNanos = timestampNanos;
+    // TOTAL DISTANCE IS KEPT IN WHOLE 1/10 M PLUS A MILLIMETER REMAINDER, SO NO DIVISION PER EDGE
+    distanceRemainder += distancePerRevolution;
+    while (distanceRemainder >= 100)
+    {
+        distanceRemainder -= 100;
+        measurement.totalDistance += 1;
+    }
+    if (counters)
+    {
+        counters->set(PersistentCounters::TotalDistance, measurement.totalDistance);
+        counters->set(PersistentCounters::DistanceRemainder, quint32(distanceRemainder));
+        counters->commit();
+    }
+    measurementChanged(timestampNanos);
+}
+
+void RscService::report()
+{
+    speedEstimator.update(clock.now());
+    const int speed = speedEstimator.speed();
+    // CADENCE IS A MANDATORY FIELD, 0 UNLESS ESTIMATED
+    const int cadence = estimateCadence ? cadenceAt(speed) : 0;
+    measurement.instantaneousSpeed = quint16(speed);
+    measurement.instantaneousCadence = quint8(cadence);
+    // ONE STEP OF TRAVEL IN 1/100 M: SPEED / 256 * 60 / CADENCE * 100
+    measurement.instantaneousStrideLength = quint16(cadence ? speed * 6000 / (256 * cadence) : 0);
+    measurement.running = speed >= RUNNING_SPEED;
+    if (publishesTelemetry())
+        publishTelemetry(beltTelemetry(beltRevolutions, lastEdgeNanos, speed, cadence, distancePerRevolution,
+                                       measurement.totalDistance, clock.now()));
+    sendMeasurement(packet, encoder(measurement, packet));
+}
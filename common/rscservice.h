@@ -0,0 +1,49 @@
+#ifndef RSCSERVICE_H
+#define RSCSERVICE_H
+
+#include "measurementencoder.h"
+#include "measurementservice.h"
+#include "speedestimator.h"
+
+class PersistentCounters;
+
+// RUNNING SPEED AND CADENCE FROM A SENSOR ON THE TREADMILL BELT ROLLER.  EVERY NOTIFICATION
+// CARRIES SPEED, TOTAL DISTANCE AND THE WALKING OR RUNNING STATUS.  THE SENSOR CANNOT MEASURE
+// CADENCE, SO IT IS 0 AND STRIDE LENGTH IS LEFT OUT UNLESS BOTH ARE ESTIMATED FROM THE SPEED
+class RscService : public MeasurementService
+{
+public:
+    // DISTANCE TRAVELLED IN ONE REVOLUTION OF THE TREADMILL IN MILLIMETERS.  estimateCadence
+    // SENDS A CADENCE READ OFF A TYPICAL SPEED TO CADENCE CURVE AND THE STRIDE LENGTH FOLLOWING
+    // FROM IT.  WITH PERSISTENT COUNTERS THE TOTAL DISTANCE CARRIES ON FROM THE LAST RUN
+    RscService(SensorInput &clock, int beltPin, int distancePerRevolution, const SpeedEstimator::Settings &speedSettings,
+               bool estimateCadence, PersistentCounters *counters);
+
+    const char *name() const override { return "rsc"; }
+    QList<int> pins() const override;
+    void handleEdge(int pin, qint64 timestampNanos) override;
+    void restoreCounters(const quint32 *values) override;
+
+protected:
+    void report() override;
+
+private:
+    typedef int (*Encoder)(const RscMeasurement &measurement, char *out);
+
+    const int beltPin;
+    const int distancePerRevolution;
+    SpeedEstimator speedEstimator;
+    const bool estimateCadence;
+    // WITH OR WITHOUT THE STRIDE LENGTH, PICKED ONCE
+    const Encoder encoder;
+    PersistentCounters *const counters;
+    // MILLIMETERS NOT YET COUNTED IN measurement.totalDistance
+    int distanceRemainder = 0;
+    // SINCE START, AND THE LATEST ONE, FOR THE TELEMETRY FEED
+    quint32 beltRevolutions = 0;
+    qint64 lastEdgeNanos = -1;
+    RscMeasurement measurement;
+    char packet[MAX_MEASUREMENT_SIZE];
+};
+
+#endif // RSCSERVICE_H
@@ -0,0 +1,616 @@
+#include "sensordaemon.h"
+#include "cscservice.h"
+#include "edgecapture.h"
+#include "ftmsservice.h"
+#include "peripheral.h"
+#include "persistentcounters.h"
+#include "rscservice.h"
+#include "sensorinput.h"
+#include "sessionrecorder.h"
+#include "telemetrypublisher.h"
+
+#include <QtCore/qcommandlineparser.h>
+#include <QtCore/qcoreapplication.h>
+#include <QtCore/qloggingcategory.h>
+#include <QtCore/qsavefile.h>
+#include <QtCore/qstringlist.h>
+#include <QtCore/qtextstream.h>
+
+namespace
+{
+// GPI BCM PIN 2
+const int WHEEL_SENSOR_PIN = 8;
+// GPI BCM PIN 3
+const int CRANK_SENSOR_PIN = 9;
+// DISTANCE TRAVELLED IN ONE REVOLUTION OF THE TREADMILL IN MILLIMETERS
+const int DISTANCE_PER_REVOLUTION = 133;
+// CENTRALS (WATCH, PHONE, TABLET...) THAT CAN SUBSCRIBE AT THE SAME TIME
+const int MAX_CENTRALS = 2;
+// HOW OFTEN THE PERSISTENT COUNTERS ARE SYNCED TO DISK IN MILLISECONDS
+const int CHECKPOINT_INTERVAL = 10000;
+// HOW OFTEN BUFFERED SESSION RECORDS ARE WRITTEN OUT IN MILLISECONDS
+const int RECORDING_FLUSH_INTERVAL = 1000;
+// HOW OFTEN THE METRICS FILE IS REWRITTEN IN MILLISECONDS
+const int METRICS_INTERVAL = 10000;
+// POLLING PERIOD IN MILLISECONDS WHILE NOTHING MOVES, LISTENED TO OR NOT.  A PULSE AT THE
+// FIRST TURN OF THE WHEEL IS LONGER THAN THIS
+const int IDLE_POLLING_INTERVAL = 50;
+// NO EDGE FOR THIS MANY MILLISECONDS COUNTS AS STANDING STILL
+const int IDLE_AFTER = 10000;
+// HOW OFTEN TO LOG CAPTURE CPU USAGE AND TIMESTAMP ERROR IN MILLISECONDS
+const int STATS_REPORTING_INTERVAL = 60000;
+
+// A STATION WITHOUT A PIN THE CAPTURE CAN WATCH WOULD NEVER SEE AN EDGE
+bool validPin(int pin)
+{
+    return pin >= 0 && pin < EdgeCapture::MAX_PINS;
+}
+
+int pinValue(const QString &text, bool *ok)
+{
+    bool valid = false;
+    const int pin = text.toInt(&valid);
+    *ok = *ok && valid && validPin(pin);
+    return pin;
+}
+
+int intValue(const QCommandLineParser &parser, const char *name, bool *ok)
+{
+    bool valid = false;
+    const int value = parser.value(QLatin1String(name)).toInt(&valid);
+    if (!valid)
+    {
+        qWarning() << "invalid value for --" << name;
+        *ok = false;
+    }
+    return value;
+}
+}
+
+SensorDaemon::SensorDaemon(const Defaults &defaults)
+    : defaults(defaults), routes(EdgeCapture::MAX_PINS)
+{
+}
+
+SensorDaemon::~SensorDaemon()
+{
+    // STOP THE CAPTURE THREAD BEFORE THE SERVICES ITS EDGES ARE ROUTED TO GO AWAY
+    capture.reset();
+    qDeleteAll(services);
+    qDeleteAll(peripherals);
+    qDeleteAll(persistentCounters);
+}
+
+void SensorDaemon::addOptions(QCommandLineParser &parser) const
+{
+    parser.addOption(QCommandLineOption("name", "Advertised local name.", "name", defaults.name));
+    parser.addOption(QCommandLineOption("profiles", "Comma separated services to host: speed, cadence, running (RSC), treadmill (FTMS).", "list", defaults.profiles));
+    parser.addOption(QCommandLineOption("wheel-pin", "wiringPi pin of the wheel sensor.", "pin", QString::number(WHEEL_SENSOR_PIN)));
+    parser.addOption(QCommandLineOption("crank-pin", "wiringPi pin of the crank sensor.", "pin", QString::number(CRANK_SENSOR_PIN)));
+    parser.addOption(QCommandLineOption("belt-pin", "wiringPi pin of the treadmill belt sensor.", "pin", QString::number(WHEEL_SENSOR_PIN)));
+    parser.addOption(QCommandLineOption("station", "One service per sensor (pair), repeat for more bikes and treadmills: speed:PIN, cadence:PIN, speed-cadence:WHEEL:CRANK, running:PIN or treadmill:PIN, optionally followed by @NAME of an --adapter peripheral. Replaces --profiles and the pin options.", "station"));
+    parser.addOption(QCommandLineOption("adapter", "Advertise a separate peripheral as NAME on the local adapter with this address, repeat for more adapters (needs Qt 6.2). Replaces --name.", "NAME=ADDRESS"));
+    parser.addOption(QCommandLineOption("distance-per-revolution", "Treadmill belt travel per sensor revolution in millimeters, above 0.", "mm", QString::number(DISTANCE_PER_REVOLUTION)));
+    parser.addOption(QCommandLineOption("speed-window", "Running speed is averaged over at most this many milliseconds of belt edges.", "ms", QString::number(SpeedEstimator::Settings().windowNanos / 1000000)));
+    parser.addOption(QCommandLineOption("speed-window-edges", "Running speed is averaged over at most this many belt edges.", "edges", QString::number(SpeedEstimator::Settings().windowEdges)));
+    parser.addOption(QCommandLineOption("speed-smoothing", "Weight of the newest running speed between 0 (exclusive) and 1, 1 turns smoothing off.", "weight", QString::number(SpeedEstimator::Settings().smoothing / 256.0)));
+    parser.addOption(QCommandLineOption("speed-stop-periods", "Running speed decays between belt edges and reads zero after this many of the last edge periods without one, 0 holds it until the stop timeout.", "periods", QString::number(SpeedEstimator::Settings().stopPeriods)));
+    parser.addOption(QCommandLineOption("estimate-cadence", "Send a running cadence and stride length estimated from the belt speed (the belt sensor cannot measure them); without it cadence is 0 and stride length is left out."));
+    parser.addOption(QCommandLineOption("poll-interval", "Sampling period in milliseconds when polling, fractions allowed (0.25).", "ms", QString::number(defaults.pollingInterval)));
+    parser.addOption(QCommandLineOption("debounce-samples", "Polling: a pin level must hold for this many samples before it counts, 1 to 15.", "samples", QString::number(EdgeFilter::Settings().hysteresisSamples)));
+    parser.addOption(QCommandLineOption("min-pulse", "Polling: a pulse must be high for this many microseconds to count as a revolution, 0 for no minimum, at most 15 poll intervals.", "us", QString::number(EdgeFilter::Settings().minPulseMicros)));
+    parser.addOption(QCommandLineOption("max-rpm", "Drop an edge sooner than one revolution at this rate after the previous one on the same pin, 0 for no limit.", "rpm", QString::number(EdgeFilter::Settings().maxRpm)));
+    parser.addOption(QCommandLineOption("idle-poll-interval", "Sampling period in milliseconds when polling while nothing moves, 0 to always poll at the full rate.", "ms", QString::number(IDLE_POLLING_INTERVAL)));
+    parser.addOption(QCommandLineOption("idle-after", "Poll at the idle period after this many milliseconds without an edge.", "ms", QString::number(IDLE_AFTER)));
+    parser.addOption(QCommandLineOption("coalesce-window", "Merge new sensor data arriving within this many milliseconds of a notification into one.", "ms", QString::number(NotificationScheduler::Settings().coalesceWindowMillis)));
+    parser.addOption(QCommandLineOption("keep-alive", "Notification period in milliseconds when nothing changes.", "ms", QString::number(NotificationScheduler::Settings().keepAliveMillis)));
+    parser.addOption(QCommandLineOption("state-file", "Memory-mapped file keeping the cumulative counters across restarts, empty to start from 0 every time.", "path", defaults.name + ".state"));
+    parser.addOption(QCommandLineOption("checkpoint-interval", "How often the counters are synced to disk in milliseconds.", "ms", QString::number(CHECKPOINT_INTERVAL)));
+    parser.addOption(QCommandLineOption("record", "Append every sensor edge and notification to this session recording.", "file"));
+    parser.addOption(QCommandLineOption("telemetry", "Publish the latest counters, speed and cadence of every station to this POSIX shared-memory segment (e.g. /bluetooth-sensors) for local readers; off when empty.", "name"));
+    parser.addOption(QCommandLineOption("metrics-file", "Write latency histograms and counters to this file in Prometheus text format; off when empty.", "file"));
+    parser.addOption(QCommandLineOption("metrics-interval", "How often the metrics file is rewritten in milliseconds.", "ms", QString::number(METRICS_INTERVAL)));
+    parser.addOption(QCommandLineOption("max-centrals", "Centrals that can be connected and subscribed at the same time.", "count", QString::number(MAX_CENTRALS)));
+    parser.addOption(EdgeCapture::modeOption());
+    parser.addOption(QCommandLineOption("realtime", "Run sensor capture with SCHED_FIFO priority and locked memory."));
+    parser.addOption(QCommandLineOption("realtime-priority", "SCHED_FIFO priority of the capture thread, 1 to 99.", "priority", QString::number(EdgeCapture::RealTimeSettings().priority)));
+    parser.addOption(QCommandLineOption("realtime-cpu", "Pin the capture thread to this (ideally isolated) CPU, -1 for any.", "cpu", QString::number(EdgeCapture::RealTimeSettings().cpu)));
+    parser.addOptions(SensorInput::options());
+}
+
+bool SensorDaemon::start(const QCommandLineParser &parser)
+{
+    // SET UP THE SENSOR INPUT.  WIRING PI ON THE BOARD, A SIMULATED PROFILE OR TRACE ELSEWHERE
+    sensorInput.reset(SensorInput::create(parser));
+    QList<Peripheral::Settings> peripheralSettings;
+    if (sensorInput.isNull() || !parsePeripherals(parser, &peripheralSettings) || !createServices(parser, peripheralSettings))
+        return false;
+
+    bool ok = true;
+    bool intervalOk = false;
+    const double pollingInterval = parser.value(QStringLiteral("poll-interval")).toDouble(&intervalOk);
+    if (!intervalOk || pollingInterval <= 0)
+    {
+        qWarning() << "invalid value for --poll-interval";
+        ok = false;
+    }
+    EdgeFilter::Settings filter;
+    filter.hysteresisSamples = intValue(parser, "debounce-samples", &ok);
+    filter.minPulseMicros = intValue(parser, "min-pulse", &ok);
+    filter.maxRpm = intValue(parser, "max-rpm", &ok);
+    if (filter.hysteresisSamples < 1 || filter.hysteresisSamples > EdgeFilter::MAX_SAMPLES)
+    {
+        qWarning() << "--debounce-samples must be 1 to" << EdgeFilter::MAX_SAMPLES;
+        ok = false;
+    }
+    // THE FILTER COUNTS A PULSE IN POLLS, SO THE LONGEST MINIMUM IT CAN HOLD DEPENDS ON THE INTERVAL
+    const qint64 maxPulseMicros = qint64(qMax(0.0, pollingInterval) * 1e6) * EdgeFilter::MAX_SAMPLES / 1000;
+    if (filter.minPulseMicros < 0 || (intervalOk && filter.minPulseMicros > maxPulseMicros))
+    {
+        qWarning() << "--min-pulse must be 0 to" << maxPulseMicros << "microseconds, at most" << EdgeFilter::MAX_SAMPLES << "polls";
+        ok = false;
+    }
+    EdgeCapture::RealTimeSettings realTime;
+    realTime.enabled = parser.isSet(QStringLiteral("realtime"));
+    realTime.priority = intValue(parser, "realtime-priority", &ok);
+    realTime.cpu = intValue(parser, "realtime-cpu", &ok);
+    EdgeCapture::IdleSettings idle;
+    idle.intervalMillis = intValue(parser, "idle-poll-interval", &ok);
+    idle.afterMillis = intValue(parser, "idle-after", &ok);
+    if (!ok)
+        return false;
+    // START ADVERTISING EVERY PERIPHERAL
+    for (Peripheral *peripheral : peripherals)
+        peripheral->start();
+
+    // CAPTURE RISING EDGES OF EVERY PIN ANY SERVICE NEEDS, FROM KERNEL GPIO EVENTS OR BY POLLING
+    capture.reset(new EdgeCapture(*sensorInput, EdgeCapture::modeFromString(parser.value(EdgeCapture::modeOption())),
+                                  qint64(pollingInterval * 1e6)));
+    capture->setRealTime(realTime);
+    capture->setIdle(idle);
+    capture->setFilter(filter);
+    for (int pin = 0; pin < routes.size(); ++pin)
+    {
+        if (!routes.at(pin).isEmpty())
+            capture->addPin(pin);
+    }
+    for (MeasurementService *service : services)
+        service->setEdgeSource([this]() { capture->drain(); });
+    if (!capture->start([this](int pin, qint64 timestampNanos) { dispatchEdge(pin, timestampNanos); }))
+        return false;
+    updateListening();
+    capture->startStatsReporting(STATS_REPORTING_INTERVAL);
+    QObject::connect(&statsTimer, &QTimer::timeout, [this]() { reportStats(); });
+    statsTimer.start(STATS_REPORTING_INTERVAL);
+    return true;
+}
+
+int SensorDaemon::run(int argc, char *argv[], const Defaults &defaults)
+{
+    QCoreApplication app(argc, argv);
+    SensorDaemon daemon(defaults);
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    daemon.addOptions(parser);
+    parser.process(app);
+
+    if (!daemon.start(parser))
+        return 1;
+    return app.exec();
+}
+
+bool SensorDaemon::parsePeripherals(const QCommandLineParser &parser, QList<Peripheral::Settings> *peripheralSettings) const
+{
+    bool ok = true;
+    Peripheral::Settings settings;
+    settings.maxCentrals = intValue(parser, "max-centrals", &ok);
+    if (!ok)
+        return false;
+    if (settings.maxCentrals < 1)
+    {
+        qWarning() << "--max-centrals must be at least 1";
+        return false;
+    }
+
+    // WITHOUT --adapter ONE PERIPHERAL ON THE DEFAULT ADAPTER, AS BEFORE
+    if (!parser.isSet(QStringLiteral("adapter")))
+    {
+        settings.name = parser.value(QStringLiteral("name"));
+        *peripheralSettings << settings;
+        return true;
+    }
+    if (!Peripheral::canSelectAdapter())
+    {
+        qWarning() << "--adapter needs Qt 6.2 or later, this build uses Qt" << QT_VERSION_STR;
+        return false;
+    }
+    for (const QString &specification : parser.values(QStringLiteral("adapter")))
+    {
+        const int separator = specification.indexOf(QLatin1Char('='));
+        settings.name = specification.left(separator);
+        settings.adapter = QBluetoothAddress(specification.mid(separator + 1));
+        if (separator <= 0 || settings.adapter.isNull())
+        {
+            qWarning() << "invalid --adapter" << specification;
+            return false;
+        }
+        if (!Peripheral::adapterExists(settings.adapter))
+        {
+            qWarning() << "no local Bluetooth adapter" << settings.adapter.toString();
+            return false;
+        }
+        *peripheralSettings << settings;
+    }
+    return true;
+}
+
+bool SensorDaemon::createServices(const QCommandLineParser &parser, const QList<Peripheral::Settings> &peripheralSettings)
+{
+    QStringList peripheralNames;
+    for (const Peripheral::Settings &settings : peripheralSettings)
+        peripheralNames << settings.name;
+
+    bool ok = true;
+    const int wheelPin = intValue(parser, "wheel-pin", &ok);
+    const int crankPin = intValue(parser, "crank-pin", &ok);
+    const int beltPin = intValue(parser, "belt-pin", &ok);
+    const int distancePerRevolution = intValue(parser, "distance-per-revolution", &ok);
+    // RUNNING AND TREADMILL DISTANCE AND SPEED ARE MULTIPLES OF IT, AND THE TELEMETRY FEED
+    // DIVIDES BY IT TO GET THE WHEEL RPM
+    if (distancePerRevolution <= 0)
+    {
+        qWarning() << "--distance-per-revolution must be positive";
+        ok = false;
+    }
+    SpeedEstimator::Settings speedSettings;
+    speedSettings.windowNanos = qint64(intValue(parser, "speed-window", &ok)) * 1000000;
+    speedSettings.windowEdges = intValue(parser, "speed-window-edges", &ok);
+    bool smoothingOk = false;
+    const double smoothing = parser.value(QStringLiteral("speed-smoothing")).toDouble(&smoothingOk);
+    if (!smoothingOk || smoothing <= 0 || smoothing > 1)
+    {
+        qWarning() << "invalid value for --speed-smoothing";
+        ok = false;
+    }
+    speedSettings.smoothing = qRound(smoothing * 256);
+    speedSettings.stopPeriods = intValue(parser, "speed-stop-periods", &ok);
+    const bool estimateCadence = parser.isSet(QStringLiteral("estimate-cadence"));
+    NotificationScheduler::Settings scheduling;
+    scheduling.coalesceWindowMillis = intValue(parser, "coalesce-window", &ok);
+    scheduling.keepAliveMillis = intValue(parser, "keep-alive", &ok);
+    const int checkpointInterval = intValue(parser, "checkpoint-interval", &ok);
+    const int metricsInterval = intValue(parser, "metrics-interval", &ok);
+    if (!ok)
+        return false;
+    metricsFile = parser.value(QStringLiteral("metrics-file"));
+
+    // A RECORDING THAT CANNOT BE OPENED IS NOT WORTH REFUSING TO START OVER
+    const QString recording = parser.value(QStringLiteral("record"));
+    if (!recording.isEmpty())
+    {
+        recorder.reset(new SessionRecorder(recording));
+        if (recorder->open(sensorInput->now()))
+            recorder->startFlushing(RECORDING_FLUSH_INTERVAL);
+        else
+            recorder.reset();
+    }
+
+    const QString telemetryName = parser.value(QStringLiteral("telemetry"));
+
+    // ONE SERVICE PER STATION.  WITHOUT --station THE PROFILES MAKE ONE CSC SERVICE (WHEEL,
+    // CRANK OR BOTH) AND ONE RSC SERVICE ON THE --*-pin PINS, AS BEFORE
+    QList<Station> stations;
+    if (parser.isSet(QStringLiteral("station")))
+    {
+        for (const QString &specification : parser.values(QStringLiteral("station")))
+        {
+            Station station;
+            if (!parseStation(specification, peripheralNames, &station))
+            {
+                qWarning() << "invalid --station" << specification;
+                return false;
+            }
+            stations << station;
+        }
+    }
+    else
+    {
+        bool speed = false;
+        bool cadence = false;
+        bool running = false;
+        bool treadmill = false;
+        for (const QString &profile : parser.value(QStringLiteral("profiles")).split(QLatin1Char(',')))
+        {
+            const QString name = profile.trimmed();
+            if (name == QLatin1String("speed"))
+                speed = true;
+            else if (name == QLatin1String("cadence"))
+                cadence = true;
+            else if (name == QLatin1String("running"))
+                running = true;
+            else if (name == QLatin1String("treadmill"))
+                treadmill = true;
+            else
+            {
+                qWarning() << "unknown profile" << name;
+                return false;
+            }
+        }
+        if ((speed && !validPin(wheelPin)) || (cadence && !validPin(crankPin)) || ((running || treadmill) && !validPin(beltPin)))
+        {
+            qWarning() << "pins must be 0 to" << EdgeCapture::MAX_PINS - 1;
+            return false;
+        }
+        if (speed || cadence)
+            stations << Station { Station::Cycling, { speed ? wheelPin : -1, cadence ? crankPin : -1 }, 0 };
+        if (running)
+            stations << Station { Station::Running, { beltPin, -1 }, 0 };
+        if (treadmill)
+            stations << Station { Station::Treadmill, { beltPin, -1 }, 0 };
+    }
+    if (stations.isEmpty())
+    {
+        qWarning() << "no profiles selected";
+        return false;
+    }
+
+    // A STATE FILE THAT CANNOT BE USED ONLY COSTS THE COUNTS OF EARLIER RUNS.  A SINGLE
+    // STATION KEEPS THE PLAIN NAME; WITH SEVERAL, EACH GETS ITS KIND AND PINS APPENDED
+    // (.speed-cadence-17-27) SO REORDERING THE STATIONS KEEPS EVERY SENSOR ON ITS OWN COUNTS.
+    // THE FILE ALSO NAMES ITS SENSOR AND IS REFUSED BY ANY OTHER.  THE TREADMILL'S FIGURES
+    // BELONG TO ONE SESSION, SO IT HAS NONE
+    const QString stateFile = parser.value(QStringLiteral("state-file"));
+    for (int i = 0; i < stations.size(); ++i)
+    {
+        const Station &station = stations.at(i);
+        PersistentCounters *counters = nullptr;
+        if (!stateFile.isEmpty() && station.kind != Station::Treadmill)
+        {
+            const QString path = stations.size() == 1
+                                     ? stateFile
+                                     : stateFile + QLatin1Char('.') + QString::fromLatin1(stationIdentity(station, '-'));
+            counters = new PersistentCounters(path, stationIdentity(station, ':'));
+            if (counters->open())
+            {
+                counters->startCheckpoints(checkpointInterval);
+                persistentCounters << counters;
+            }
+            else
+            {
+                delete counters;
+                counters = nullptr;
+            }
+        }
+        MeasurementService *service;
+        if (station.kind == Station::Cycling)
+            service = new CscService(*sensorInput, station.pins[0], station.pins[1], counters);
+        else if (station.kind == Station::Running)
+            service = new RscService(*sensorInput, station.pins[0], distancePerRevolution, speedSettings, estimateCadence, counters);
+        else
+            service = new FtmsService(*sensorInput, station.pins[0], distancePerRevolution, speedSettings);
+        service->setLabel(stations.size() == 1 ? QString::fromLatin1(service->name())
+                                               : QString::fromLatin1(service->name()) + QString::number(i));
+        // THE ANALYZER REPLAYS THE SESSION FROM THE SAME COUNTS, FINDING THE STATION BY ITS FIRST PIN
+        if (recorder && counters)
+        {
+            const int firstPin = station.pins[0] >= 0 ? station.pins[0] : station.pins[1];
+            recorder->recordCounters(service->measurementCharacteristic(), firstPin, sensorInput->now(), counters->values(),
+                                     PersistentCounters::COUNTER_COUNT);
+        }
+        services << service;
+    }
+
+    // LIKE THE RECORDING, A FEED THAT CANNOT BE CREATED DOES NOT STOP THE DAEMON
+    if (!telemetryName.isEmpty())
+    {
+        telemetry.reset(new TelemetryPublisher(telemetryName));
+        if (telemetry->open(services.size()))
+        {
+            const Telemetry::Kind kinds[] = { Telemetry::Cycling, Telemetry::Running, Telemetry::Treadmill };
+            for (int i = 0; i < stations.size(); ++i)
+                telemetry->setStation(i, kinds[stations.at(i).kind], services.at(i)->label());
+        }
+        else
+        {
+            telemetry.reset();
+        }
+    }
+
+    // EACH PERIPHERAL GETS ITS OWN GATT DATABASE OF THE STATIONS ASSIGNED TO IT
+    for (int i = 0; i < peripheralSettings.size(); ++i)
+    {
+        QList<MeasurementService *> hosted;
+        for (int j = 0; j < stations.size(); ++j)
+        {
+            if (stations.at(j).peripheral == i)
+                hosted << services.at(j);
+        }
+        if (hosted.isEmpty())
+        {
+            qWarning() << "no --station for" << peripheralSettings.at(i).name;
+            return false;
+        }
+        peripherals << new Peripheral(peripheralSettings.at(i), hosted);
+    }
+
+    if (!metricsFile.isEmpty())
+    {
+        QObject::connect(&metricsTimer, &QTimer::timeout, [this]() { writeMetrics(); });
+        metricsTimer.start(metricsInterval);
+    }
+    for (MeasurementService *service : services)
+    {
+        if (!metricsFile.isEmpty())
+            service->enableMetrics();
+        service->startReporting(scheduling);
+        service->setRecorder(recorder.data());
+        service->setSubscriptionCallback([this]() { updateListening(); });
+        if (telemetry)
+            service->setTelemetry(telemetry.data(), services.indexOf(service));
+        for (int pin : service->pins())
+        {
+            if (pin < 0 || pin >= routes.size())
+            {
+                qWarning() << "pin" << pin << "out of range 0 to" << routes.size() - 1;
+                return false;
+            }
+            routes[pin] << service;
+        }
+    }
+    return true;
+}
+
+void SensorDaemon::dispatchEdge(int pin, qint64 timestampNanos)
+{
+    if (recorder)
+        recorder->recordEdge(pin, timestampNanos);
+    for (MeasurementService *service : routes.at(pin))
+    {
+        MeasurementService::Metrics &metrics = service->metrics();
+        if (!metrics.enabled)
+        {
+            service->handleEdge(pin, timestampNanos);
+            continue;
+        }
+        const qint64 started = SensorInput::monotonicNanos();
+        service->handleEdge(pin, timestampNanos);
+        metrics.edgeHandling.record(SensorInput::monotonicNanos() - started);
+    }
+}
+
+void SensorDaemon::updateListening()
+{
+    if (!capture)
+        return;
+    bool listening = false;
+    for (const MeasurementService *service : services)
+        listening = listening || service->hasReceivers();
+    capture->setListening(listening);
+}
+
+void SensorDaemon::reportStats()
+{
+    for (const MeasurementService *service : services)
+    {
+        const NotificationScheduler::Counters &counters = service->notificationCounters();
+        qInfo().nospace() << service->label() << " notifications: " << counters.sent << " sent, "
+                          << counters.coalesced << " coalesced, " << counters.skipped << " skipped";
+    }
+    if (recorder)
+        qInfo().nospace() << "session recording: " << recorder->recorded() << " records, " << recorder->dropped() << " dropped";
+    for (const Peripheral *peripheral : peripherals)
+        peripheral->reportStats();
+}
+
+void SensorDaemon::writeMetrics() const
+{
+    QSaveFile file(metricsFile);
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        qWarning() << "cannot write metrics to" << metricsFile << file.errorString();
+        return;
+    }
+    QTextStream out(&file);
+    writeMetrics(out);
+    out.flush();
+    if (!file.commit())
+        qWarning() << "cannot write metrics to" << metricsFile << file.errorString();
+}
+
+void SensorDaemon::writeMetrics(QTextStream &out) const
+{
+    out << "# TYPE sensor_edges_total counter\n";
+    for (const MeasurementService *service : services)
+        out << "sensor_edges_total{service=\"" << service->label() << "\"} " << service->metrics().edges << '\n';
+    out << "# TYPE sensor_notifications_total counter\n";
+    for (const MeasurementService *service : services)
+        out << "sensor_notifications_total{service=\"" << service->label() << "\"} " << service->metrics().notifications << '\n';
+    out << "# TYPE sensor_notifications_skipped_total counter\n";
+    for (const MeasurementService *service : services)
+        out << "sensor_notifications_skipped_total{service=\"" << service->label() << "\"} " << service->notificationCounters().skipped << '\n';
+    out << "# TYPE sensor_notifications_dropped_total counter\n";
+    for (const Peripheral *peripheral : peripherals)
+    {
+        for (const MeasurementService *service : peripheral->services())
+        {
+            for (int slot = 0; slot < peripheral->centralSlots(); ++slot)
+            {
+                out << "sensor_notifications_dropped_total{service=\"" << service->label() << "\",central=\"" << slot << "\"} "
+                    << service->fanOutCounters(slot).dropped << '\n';
+            }
+        }
+    }
+
+    const struct
+    {
+        const char *name;
+        Histogram MeasurementService::Metrics::*histogram;
+    } histograms[] = {
+        { "sensor_edge_handling_seconds", &MeasurementService::Metrics::edgeHandling },
+        { "sensor_edge_to_notify_seconds", &MeasurementService::Metrics::edgeToNotify },
+        { "sensor_notify_call_seconds", &MeasurementService::Metrics::notifyCall },
+        { "sensor_timer_lateness_seconds", &MeasurementService::Metrics::timerLateness }
+    };
+    for (const auto &histogram : histograms)
+    {
+        out << "# TYPE " << histogram.name << " histogram\n";
+        for (const MeasurementService *service : services)
+        {
+            const QString labels = QStringLiteral("service=\"%1\"").arg(service->label());
+            (service->metrics().*histogram.histogram).writePrometheus(out, histogram.name, labels);
+        }
+    }
+
+    if (capture)
+    {
+        const EdgeCapture::Stats stats = capture->stats();
+        out << "# TYPE sensor_capture_edges_total counter\n"
+            << "sensor_capture_edges_total " << stats.edges << '\n'
+            << "# TYPE sensor_capture_overflows_total counter\n"
+            << "sensor_capture_overflows_total " << stats.overflows << '\n'
+            << "# TYPE sensor_capture_timestamp_error_max_seconds gauge\n"
+            << "sensor_capture_timestamp_error_max_seconds " << double(stats.timestampErrorMaxNanos) / 1e9 << '\n'
+            << "# TYPE sensor_capture_glitches_total counter\n"
+            << "sensor_capture_glitches_total " << stats.glitches << '\n'
+            << "# TYPE sensor_capture_refractory_rejects_total counter\n"
+            << "sensor_capture_refractory_rejects_total " << stats.refractoryRejects << '\n';
+    }
+}
+
+bool SensorDaemon::parseStation(const QString &specification, const QStringList &peripheralNames, Station *station)
+{
+    // KIND:PINS[@PERIPHERAL]
+    const int at = specification.indexOf(QLatin1Char('@'));
+    const QStringList parts = specification.left(at).split(QLatin1Char(':'));
+    bool ok = true;
+    const QString kind = parts.first();
+    if (kind == QLatin1String("speed-cadence") && parts.size() == 3)
+        *station = Station { Station::Cycling, { pinValue(parts.at(1), &ok), pinValue(parts.at(2), &ok) }, 0 };
+    else if (kind == QLatin1String("speed") && parts.size() == 2)
+        *station = Station { Station::Cycling, { pinValue(parts.at(1), &ok), -1 }, 0 };
+    else if (kind == QLatin1String("cadence") && parts.size() == 2)
+        *station = Station { Station::Cycling, { -1, pinValue(parts.at(1), &ok) }, 0 };
+    else if (kind == QLatin1String("running") && parts.size() == 2)
+        *station = Station { Station::Running, { pinValue(parts.at(1), &ok), -1 }, 0 };
+    else if (kind == QLatin1String("treadmill") && parts.size() == 2)
+        *station = Station { Station::Treadmill, { pinValue(parts.at(1), &ok), -1 }, 0 };
+    else
+        return false;
+    station->peripheral = at < 0 ? 0 : peripheralNames.indexOf(specification.mid(at + 1));
+    return ok && station->peripheral >= 0;
+}
+
+QByteArray SensorDaemon::stationIdentity(const Station &station, char separator)
+{
+    QByteArray identity;
+    if (station.kind == Station::Cycling)
+        identity = station.pins[0] < 0 ? "cadence" : station.pins[1] < 0 ? "speed" : "speed-cadence";
+    else
+        identity = station.kind == Station::Running ? "running" : "treadmill";
+    for (int pin : station.pins)
+    {
+        if (pin >= 0)
+            identity += separator + QByteArray::number(pin);
+    }
+    return identity;
+}
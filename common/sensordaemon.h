@@ -0,0 +1,99 @@
+#ifndef SENSORDAEMON_H
+#define SENSORDAEMON_H
+
+#include "peripheral.h"
+
+#include <QtCore/qlist.h>
+#include <QtCore/qscopedpointer.h>
+#include <QtCore/qstring.h>
+#include <QtCore/qstringlist.h>
+#include <QtCore/qtimer.h>
+#include <QtCore/qvector.h>
+
+class EdgeCapture;
+class MeasurementService;
+class PersistentCounters;
+class QCommandLineParser;
+class QTextStream;
+class SensorInput;
+class SessionRecorder;
+class TelemetryPublisher;
+
+// HOSTS ANY COMBINATION OF THE CSC (WHEEL, CRANK, BOTH), RSC AND FTMS SERVICES FROM ONE EDGE
+// CAPTURE AND ONE EVENT LOOP.  THE PER-PROFILE BINARIES ARE THIN WRAPPERS THAT ONLY CHANGE
+// THE DEFAULTS.  THE SERVICES ARE SPLIT OVER ONE PERIPHERAL PER BLUETOOTH ADAPTER, EACH WITH
+// ITS OWN NAME, GATT DATABASE AND CENTRALS, WHILE THE CAPTURE STAYS SHARED.
+class SensorDaemon
+{
+public:
+    struct Defaults
+    {
+        // ADVERTISED LOCAL NAME
+        QString name;
+        // COMMA SEPARATED: speed, cadence, running, treadmill
+        QString profiles;
+        // POLLING INTERVAL IN MILLISECONDS WHEN KERNEL EDGE EVENTS ARE NOT USED
+        int pollingInterval;
+    };
+
+    explicit SensorDaemon(const Defaults &defaults);
+    ~SensorDaemon();
+
+    void addOptions(QCommandLineParser &parser) const;
+    bool start(const QCommandLineParser &parser);
+
+    static int run(int argc, char *argv[], const Defaults &defaults);
+
+private:
+    // ONE SERVICE INSTANCE AND THE PINS FEEDING IT
+    struct Station
+    {
+        enum Kind
+        {
+            Cycling,
+            Running,
+            Treadmill
+        } kind;
+        // CYCLING: WHEEL AND CRANK, RUNNING AND TREADMILL: BELT.  -1 WHEN NOT FITTED
+        int pins[2];
+        // INDEX OF THE PERIPHERAL SERVING IT
+        int peripheral;
+    };
+
+    // ONE PER --adapter, OR ONE ON THE DEFAULT ADAPTER
+    bool parsePeripherals(const QCommandLineParser &parser, QList<Peripheral::Settings> *peripheralSettings) const;
+    bool createServices(const QCommandLineParser &parser, const QList<Peripheral::Settings> &peripheralSettings);
+    static bool parseStation(const QString &specification, const QStringList &peripheralNames, Station *station);
+    // THE SENSOR OF A STATION AS IN --station, e.g. "speed-cadence:17:27", WITH separator
+    // BETWEEN KIND AND PINS
+    static QByteArray stationIdentity(const Station &station, char separator);
+    void dispatchEdge(int pin, qint64 timestampNanos);
+    // A CENTRAL SUBSCRIBING CUTS THE CURRENT IDLE POLLING SLEEP SHORT
+    void updateListening();
+    void reportStats();
+    // PROMETHEUS TEXT FORMAT, REPLACED ATOMICALLY SO A SCRAPER NEVER SEES HALF A FILE
+    void writeMetrics() const;
+    void writeMetrics(QTextStream &out) const;
+
+    const Defaults defaults;
+    QScopedPointer<SensorInput> sensorInput;
+    QScopedPointer<EdgeCapture> capture;
+    // ONE PER STATION WHOSE STATE FILE COULD BE OPENED, DELETED AFTER THE SERVICES
+    QList<PersistentCounters *> persistentCounters;
+    QScopedPointer<SessionRecorder> recorder;
+    QScopedPointer<TelemetryPublisher> telemetry;
+    // DELETED AFTER THE SERVICES, WHOSE QLowEnergyServices BELONG TO THEIR CONTROLLERS
+    QList<Peripheral *> peripherals;
+    // ONE PER STATION, IN STATION ORDER
+    QList<MeasurementService *> services;
+    // SERVICES FED BY EACH PIN, INDEXED BY PIN
+    QVector<QList<MeasurementService *>> routes;
+    QTimer statsTimer;
+    QString metricsFile;
+    QTimer metricsTimer;
+
+    SensorDaemon(const SensorDaemon &) = delete;
+    SensorDaemon &operator=(const SensorDaemon &) = delete;
+};
+
+#endif // SENSORDAEMON_H
@@ -0,0 +1,145 @@
+#include "sensorinput.h"
+#include "simulatedsensorinput.h"
+#include "timebase.h"
+
+#include <QtCore/qcommandlineparser.h>
+#include <QtCore/qloggingcategory.h>
+#include <time.h>
+#ifdef HAVE_WIRINGPI
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <wiringPi.h>
+#endif
+
+#ifdef HAVE_WIRINGPI
+namespace
+{
+const size_t GPIO_BLOCK_SIZE = 4096;
+// GPLEV0, THE LEVELS OF BCM GPIO 0 TO 31, IN 32 BIT WORDS FROM THE START OF THE GPIO BLOCK
+const int GPLEV0 = 0x34 / 4;
+}
+#endif
+
+QList<QCommandLineOption> SensorInput::options()
+{
+    return QList<QCommandLineOption>()
+           << QCommandLineOption("simulate", "Generate sensor edges instead of reading GPIO, e.g. 8:120@0,600@30 ramps pin 8 from 120 to 600 rpm over 30 s. Repeat for more pins.", "profile")
+           << QCommandLineOption("replay", "Replay rising edges from a trace file of \"pin microseconds\" lines instead of reading GPIO.", "file");
+}
+
+SensorInput *SensorInput::create(const QCommandLineParser &parser)
+{
+    const QStringList profiles = parser.values(QStringLiteral("simulate"));
+    const QString trace = parser.value(QStringLiteral("replay"));
+    if (profiles.isEmpty() && trace.isEmpty())
+    {
+#ifdef HAVE_WIRINGPI
+        return new WiringPiSensorInput;
+#else
+        qWarning() << "built without wiringPi, use --simulate or --replay to provide sensor input";
+        return nullptr;
+#endif
+    }
+
+    SimulatedSensorInput *input = new SimulatedSensorInput;
+    bool valid = trace.isEmpty() || input->loadTrace(trace);
+    for (const QString &profile : profiles)
+        valid = valid && input->setProfile(profile);
+    if (!valid)
+    {
+        delete input;
+        return nullptr;
+    }
+    return input;
+}
+
+quint64 SensorInput::readBank(quint64 pins)
+{
+    quint64 levels = 0;
+    for (; pins; pins &= pins - 1)
+    {
+        const int pin = __builtin_ctzll(pins);
+        if (read(pin))
+            levels |= quint64(1) << pin;
+    }
+    return levels;
+}
+
+qint64 SensorInput::monotonicNanos()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return qint64(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+#ifdef HAVE_WIRINGPI
+WiringPiSensorInput::WiringPiSensorInput()
+{
+    // SET UP WIRING PI CONNECTION
+    wiringPiSetup();
+    for (int &bcm : bcmOfPin)
+        bcm = -1;
+
+    // /dev/gpiomem MAPS ONLY THE GPIO BLOCK AND NEEDS NO ROOT, ON EVERY PI MODEL
+    const int fd = ::open("/dev/gpiomem", O_RDWR | O_SYNC | O_CLOEXEC);
+    if (fd >= 0)
+    {
+        void *block = mmap(nullptr, GPIO_BLOCK_SIZE, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (block != MAP_FAILED)
+            gpio = static_cast<volatile quint32 *>(block);
+    }
+    if (!gpio)
+        qWarning() << "cannot map /dev/gpiomem, reading pins one at a time";
+}
+
+WiringPiSensorInput::~WiringPiSensorInput()
+{
+    if (gpio)
+        munmap(const_cast<quint32 *>(gpio), GPIO_BLOCK_SIZE);
+}
+
+void WiringPiSensorInput::configurePin(int pin)
+{
+    pinMode(pin, INPUT);
+    if (pin >= 0 && pin < 64)
+    {
+        const int bcm = wpiPinToGpio(pin);
+        bcmOfPin[pin] = bcm >= 0 && bcm < 32 ? bcm : -1;
+    }
+}
+
+quint64 WiringPiSensorInput::readBank(quint64 pins)
+{
+    if (!gpio)
+        return SensorInput::readBank(pins);
+    // ONE REGISTER READ FOR ALL PINS, THEN ONLY BIT SHUFFLING FROM BCM TO WIRING PI NUMBERS
+    const quint32 bank = gpio[GPLEV0];
+    quint64 levels = 0;
+    for (; pins; pins &= pins - 1)
+    {
+        const int pin = __builtin_ctzll(pins);
+        const int bcm = bcmOfPin[pin];
+        if (bcm < 0 ? digitalRead(pin) : (bank >> bcm) & 1)
+            levels |= quint64(1) << pin;
+    }
+    return levels;
+}
+
+int WiringPiSensorInput::read(int pin)
+{
+    return digitalRead(pin);
+}
+
+qint64 WiringPiSensorInput::now()
+{
+    return Timebase::now();
+}
+
+int WiringPiSensorInput::lineOffset(int pin) const
+{
+    // wiringPi numbering is what the services use, the kernel wants the BCM line offset
+    return wpiPinToGpio(pin);
+}
+#endif
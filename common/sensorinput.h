@@ -0,0 +1,60 @@
+#ifndef SENSORINPUT_H
+#define SENSORINPUT_H
+
+#include <QtCore/qcommandlineoption.h>
+#include <QtCore/qglobal.h>
+#include <QtCore/qlist.h>
+
+class QCommandLineParser;
+
+// WHERE THE HALL SENSOR LEVELS COME FROM.  THE WIRING PI BACKEND READS THE REAL PINS,
+// THE SIMULATED BACKEND GENERATES THEM SO THE SERVICES CAN RUN AND BE PROFILED OFF A PI.
+class SensorInput
+{
+public:
+    virtual ~SensorInput() {}
+
+    virtual void configurePin(int pin) = 0;
+    virtual int read(int pin) = 0;
+    // LEVELS OF EVERY PIN IN pins (BIT n IS PIN n) IN ONE GO.  BACKENDS THAT CAN READ A WHOLE
+    // GPIO BANK AT ONCE OVERRIDE THIS, THE DEFAULT READS THE PINS ONE BY ONE
+    virtual quint64 readBank(quint64 pins);
+    // timestamps in nanoseconds, on the Timebase (CLOCK_MONOTONIC_RAW) for real hardware
+    virtual qint64 now() = 0;
+    // kernel GPIO line offset for edge events, -1 when the backend has no GPIO lines
+    virtual int lineOffset(int pin) const
+    {
+        Q_UNUSED(pin);
+        return -1;
+    }
+
+    static QList<QCommandLineOption> options();
+    // RETURNS NULL AND LOGS WHY WHEN THE OPTIONS DO NOT DESCRIBE A USABLE INPUT
+    static SensorInput *create(const QCommandLineParser &parser);
+    // CLOCK_MONOTONIC, FOR TIMING THE CODE ITSELF RATHER THAN SENSOR EVENTS
+    static qint64 monotonicNanos();
+};
+
+#ifdef HAVE_WIRINGPI
+class WiringPiSensorInput : public SensorInput
+{
+public:
+    WiringPiSensorInput();
+
+    ~WiringPiSensorInput() override;
+
+    void configurePin(int pin) override;
+    int read(int pin) override;
+    // ONE READ OF THE GPLEV0 REGISTER THROUGH /dev/gpiomem WHEN IT CAN BE MAPPED
+    quint64 readBank(quint64 pins) override;
+    qint64 now() override;
+    int lineOffset(int pin) const override;
+
+private:
+    volatile quint32 *gpio = nullptr;
+    // BCM GPIO NUMBER OF EVERY CONFIGURED WIRING PI PIN, -1 WHEN IT IS NOT IN BANK 0
+    int bcmOfPin[64];
+};
+#endif
+
+#endif // SENSORINPUT_H
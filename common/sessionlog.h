@@ -0,0 +1,100 @@
+#ifndef SESSIONLOG_H
+#define SESSIONLOG_H
+
+#include <QtCore/qglobal.h>
+
+// ON-DISK FORMAT OF THE SESSION RECORDING, SHARED BY THE RECORDER AND THE READER.
+//
+// THE FILE IS A PLAIN SEQUENCE OF RECORDS, EACH STARTING WITH A TYPE BYTE.  EVERY RUN OF THE
+// DAEMON APPENDS A SESSION RECORD FIRST; AFTER IT, TIMESTAMPS ARE ZIGZAG VARINT DELTAS IN
+// NANOSECONDS FROM THE PREVIOUS RECORD, SO A TYPICAL EDGE TAKES 5 BYTES.  ALL TIMESTAMPS BUT
+// wallClockNanos ARE ON THE SENSOR CLOCK (Timebase::now(), CLOCK_MONOTONIC_RAW).
+//
+//   Session       'S' 'B' 'S' 'R' version:u8 wallClockNanos:i64le sensorClockNanos:i64le
+//   Edge          'E' delta:zigzag pin:varint
+//   Notification  'N' delta:zigzag characteristic:u16le size:varint payload[size]
+//   Counters      'C' delta:zigzag characteristic:u16le pin:varint count:varint value:varint[count]
+//
+// A COUNTERS RECORD FOLLOWS THE SESSION RECORD FOR EVERY STATION THAT RESTORED ITS CUMULATIVE
+// COUNTERS FROM A STATE FILE.  THE STATION IS THE ONE NOTIFYING characteristic WHOSE FIRST PIN
+// IS pin, THE VALUES ARE INDEXED BY PersistentCounters::Counter.  VERSION 1 HAD NONE.
+namespace SessionLog
+{
+enum RecordType
+{
+    SessionRecord = 'S',
+    EdgeRecord = 'E',
+    NotificationRecord = 'N',
+    CountersRecord = 'C'
+};
+enum
+{
+    VERSION = 2,
+    // NOTIFICATION PAYLOADS ARE CUT TO THIS MANY BYTES
+    MAX_PAYLOAD = 32,
+    MAX_COUNTERS = 8,
+    // NO RECORD IS LONGER THAN THIS: A FULL COUNTERS RECORD, A FEW BYTES LONGER THAN A FULL
+    // NOTIFICATION
+    MAX_RECORD = 1 + 10 + 2 + 5 + 5 + 5 * MAX_COUNTERS,
+    SESSION_RECORD_SIZE = 1 + 3 + 1 + 8 + 8
+};
+
+static_assert(1 + 10 + 2 + 5 + MAX_PAYLOAD <= MAX_RECORD, "a notification record must fit");
+
+inline int putVarint(char *out, quint64 value)
+{
+    int size = 0;
+    while (value >= 0x80)
+    {
+        out[size++] = char(value | 0x80);
+        value >>= 7;
+    }
+    out[size++] = char(value);
+    return size;
+}
+
+inline int putZigzag(char *out, qint64 value)
+{
+    return putVarint(out, (quint64(value) << 1) ^ quint64(value >> 63));
+}
+
+inline void putInt64(char *out, qint64 value)
+{
+    for (int i = 0; i < 8; ++i)
+        out[i] = char(quint64(value) >> (8 * i));
+}
+
+// RETURN THE NUMBER OF BYTES READ, 0 IF THE VALUE DOES NOT END BEFORE end
+inline int getVarint(const char *in, const char *end, quint64 *value)
+{
+    quint64 result = 0;
+    for (int i = 0; i < 10 && in + i < end; ++i)
+    {
+        result |= quint64(uchar(in[i]) & 0x7f) << (7 * i);
+        if (!(uchar(in[i]) & 0x80))
+        {
+            *value = result;
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+inline int getZigzag(const char *in, const char *end, qint64 *value)
+{
+    quint64 encoded = 0;
+    const int size = getVarint(in, end, &encoded);
+    *value = qint64(encoded >> 1) ^ -qint64(encoded & 1);
+    return size;
+}
+
+inline qint64 getInt64(const char *in)
+{
+    quint64 value = 0;
+    for (int i = 0; i < 8; ++i)
+        value |= quint64(uchar(in[i])) << (8 * i);
+    return qint64(value);
+}
+}
+
+#endif // SESSIONLOG_H
@@ -0,0 +1,121 @@
+#include "sessionreader.h"
+
+#include <QtCore/qiodevice.h>
+#include <cstring>
+
+SessionReader::SessionReader(QIODevice *device)
+    : device(device), data(buffer)
+{
+}
+
+SessionReader::SessionReader(const char *data, qint64 size)
+    : device(nullptr), data(data), available(size)
+{
+}
+
+void SessionReader::refill()
+{
+    if (!device || available - position >= SessionLog::MAX_RECORD)
+        return;
+    memmove(buffer, buffer + position, available - position);
+    available -= position;
+    position = 0;
+    while (available < BUFFER_SIZE)
+    {
+        const qint64 read = device->read(buffer + available, BUFFER_SIZE - available);
+        if (read <= 0)
+            break;
+        available += read;
+    }
+}
+
+bool SessionReader::next(Event &event)
+{
+    refill();
+    if (position == available)
+        return false;
+    const char *in = data + position;
+    const char *const end = data + available;
+    corrupt = true;
+
+    event.type = SessionLog::RecordType(*in++);
+    if (event.type == SessionLog::SessionRecord)
+    {
+        if (end - in < SessionLog::SESSION_RECORD_SIZE - 1 || memcmp(in, "BSR", 3) != 0 || in[3] < 1
+            || in[3] > char(SessionLog::VERSION))
+            return false;
+        const qint64 wallClock = SessionLog::getInt64(in + 4);
+        previousNanos = SessionLog::getInt64(in + 12);
+        wallClockOffset = wallClock - previousNanos;
+        in += SessionLog::SESSION_RECORD_SIZE - 1;
+        ++session;
+    }
+    else if (event.type == SessionLog::EdgeRecord || event.type == SessionLog::NotificationRecord
+             || event.type == SessionLog::CountersRecord)
+    {
+        // EVERYTHING AFTER A SESSION RECORD IS TIMED RELATIVE TO IT
+        if (session == 0)
+            return false;
+        qint64 delta = 0;
+        int size = SessionLog::getZigzag(in, end, &delta);
+        if (size == 0)
+            return false;
+        in += size;
+        previousNanos += delta;
+        quint64 value = 0;
+        if (event.type == SessionLog::EdgeRecord)
+        {
+            if ((size = SessionLog::getVarint(in, end, &value)) == 0)
+                return false;
+            in += size;
+            event.pin = int(value);
+        }
+        else if (event.type == SessionLog::CountersRecord)
+        {
+            if (end - in < 2)
+                return false;
+            event.characteristic = quint16(uchar(in[0]) | uchar(in[1]) << 8);
+            in += 2;
+            if ((size = SessionLog::getVarint(in, end, &value)) == 0)
+                return false;
+            in += size;
+            event.pin = int(value);
+            if ((size = SessionLog::getVarint(in, end, &value)) == 0 || value > SessionLog::MAX_COUNTERS)
+                return false;
+            in += size;
+            event.size = int(value);
+            for (int i = 0; i < event.size; ++i)
+            {
+                if ((size = SessionLog::getVarint(in, end, &value)) == 0)
+                    return false;
+                in += size;
+                event.counters[i] = quint32(value);
+            }
+        }
+        else
+        {
+            if (end - in < 2)
+                return false;
+            event.characteristic = quint16(uchar(in[0]) | uchar(in[1]) << 8);
+            in += 2;
+            if ((size = SessionLog::getVarint(in, end, &value)) == 0 || value > SessionLog::MAX_PAYLOAD
+                || end - (in + size) < qint64(value))
+                return false;
+            in += size;
+            event.size = int(value);
+            memcpy(event.payload, in, event.size);
+            in += event.size;
+        }
+    }
+    else
+    {
+        return false;
+    }
+
+    event.session = session;
+    event.timestampNanos = previousNanos;
+    event.wallClockNanos = previousNanos + wallClockOffset;
+    position = in - data;
+    corrupt = false;
+    return true;
+}
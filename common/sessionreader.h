@@ -0,0 +1,64 @@
+#ifndef SESSIONREADER_H
+#define SESSIONREADER_H
+
+#include "sessionlog.h"
+
+class QIODevice;
+
+// STREAMS THE RECORDS OF A SESSION RECORDING BACK ONE AT A TIME.  ONLY A FIXED BUFFER IS
+// HELD, SO A MULTI-HOUR RECORDING TAKES NO MORE MEMORY THAN A SHORT ONE.  A RECORD CUT OFF
+// BY A CRASH ENDS THE STREAM AND SETS truncated().  A RECORDING ALREADY IN MEMORY (E.G. MAPPED
+// WITH QFile::map()) IS READ IN PLACE, WITHOUT THE BUFFER OR ANY COPY.
+class SessionReader
+{
+public:
+    struct Event
+    {
+        SessionLog::RecordType type;
+        // COUNTS FROM 1 WITH EVERY SESSION RECORD
+        int session;
+        // SENSOR CLOCK OF THE RECORDING DAEMON (SEE Timebase), AND THE SAME MOMENT ON THE WALL CLOCK
+        qint64 timestampNanos;
+        qint64 wallClockNanos;
+        // EDGE ONLY
+        int pin;
+        // NOTIFICATION AND COUNTERS
+        quint16 characteristic;
+        // PAYLOAD BYTES OR COUNTER VALUES
+        int size;
+        // NOTIFICATION ONLY
+        char payload[SessionLog::MAX_PAYLOAD];
+        // COUNTERS ONLY, ALSO SETS pin
+        quint32 counters[SessionLog::MAX_COUNTERS];
+    };
+
+    explicit SessionReader(QIODevice *device);
+    // THE DATA MUST STAY VALID WHILE THE READER IS USED
+    SessionReader(const char *data, qint64 size);
+
+    // FALSE AT THE END OF THE RECORDING OR AT THE FIRST RECORD THAT CANNOT BE READ
+    bool next(Event &event);
+    bool truncated() const { return corrupt; }
+
+private:
+    enum
+    {
+        BUFFER_SIZE = 64 * 1024
+    };
+
+    // MAKES AT LEAST MAX_RECORD BYTES AVAILABLE UNLESS THE DEVICE ENDS FIRST
+    void refill();
+
+    QIODevice *const device;
+    char buffer[BUFFER_SIZE];
+    // THE BUFFER, OR THE WHOLE RECORDING WHEN IT IS IN MEMORY
+    const char *data;
+    qint64 position = 0;
+    qint64 available = 0;
+    bool corrupt = false;
+    int session = 0;
+    qint64 previousNanos = 0;
+    qint64 wallClockOffset = 0;
+};
+
+#endif // SESSIONREADER_H
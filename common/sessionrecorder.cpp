@@ -0,0 +1,170 @@
+#include "sessionrecorder.h"
+#include "sessionlog.h"
+
+#include <QtCore/qdatetime.h>
+#include <QtCore/qloggingcategory.h>
+#include <cstring>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+SessionRecorder::SessionRecorder(const QString &path)
+    : path(path)
+{
+}
+
+SessionRecorder::~SessionRecorder()
+{
+    if (fd < 0)
+        return;
+    {
+        std::unique_lock<std::mutex> lock(writerMutex);
+        // THE LAST PARTIAL BUFFER WAITS FOR THE ONE IN FLIGHT, SHUTDOWN MAY BLOCK
+        writeWanted.wait(lock, [this]() { return writing < 0; });
+        if (used > 0)
+        {
+            writing = active;
+            writingSize = used;
+        }
+        stopping = true;
+    }
+    writeWanted.notify_all();
+    writer.join();
+    ::close(fd);
+}
+
+bool SessionRecorder::open(qint64 sensorClockNanos)
+{
+    fd = ::open(path.toLocal8Bit().constData(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+        qWarning() << "cannot open session recording" << path << strerror(errno);
+        return false;
+    }
+    writer = std::thread([this]() { writeLoop(); });
+
+    char record[SessionLog::SESSION_RECORD_SIZE];
+    record[0] = char(SessionLog::SessionRecord);
+    memcpy(record + 1, "BSR", 3);
+    record[4] = char(SessionLog::VERSION);
+    SessionLog::putInt64(record + 5, QDateTime::currentMSecsSinceEpoch() * 1000000);
+    SessionLog::putInt64(record + 13, sensorClockNanos);
+    previousNanos = sensorClockNanos;
+    append(record, sizeof(record));
+    return true;
+}
+
+void SessionRecorder::recordEdge(int pin, qint64 timestampNanos)
+{
+    char record[SessionLog::MAX_RECORD];
+    int size = 0;
+    record[size++] = char(SessionLog::EdgeRecord);
+    size += SessionLog::putZigzag(record + size, timestampNanos - previousNanos);
+    size += SessionLog::putVarint(record + size, quint64(pin));
+    // A DROPPED RECORD MUST NOT BECOME THE BASE OF THE NEXT DELTA
+    if (append(record, size))
+        previousNanos = timestampNanos;
+}
+
+void SessionRecorder::recordNotification(quint16 characteristic, qint64 timestampNanos, const char *value, int valueSize)
+{
+    char record[SessionLog::MAX_RECORD];
+    int size = 0;
+    record[size++] = char(SessionLog::NotificationRecord);
+    size += SessionLog::putZigzag(record + size, timestampNanos - previousNanos);
+    record[size++] = char(characteristic);
+    record[size++] = char(characteristic >> 8);
+    valueSize = qMin(valueSize, int(SessionLog::MAX_PAYLOAD));
+    size += SessionLog::putVarint(record + size, quint64(valueSize));
+    memcpy(record + size, value, valueSize);
+    size += valueSize;
+    // A DROPPED RECORD MUST NOT BECOME THE BASE OF THE NEXT DELTA
+    if (append(record, size))
+        previousNanos = timestampNanos;
+}
+
+void SessionRecorder::recordCounters(quint16 characteristic, int pin, qint64 timestampNanos, const quint32 *values, int count)
+{
+    char record[SessionLog::MAX_RECORD];
+    int size = 0;
+    record[size++] = char(SessionLog::CountersRecord);
+    size += SessionLog::putZigzag(record + size, timestampNanos - previousNanos);
+    record[size++] = char(characteristic);
+    record[size++] = char(characteristic >> 8);
+    size += SessionLog::putVarint(record + size, quint64(pin));
+    count = qMin(count, int(SessionLog::MAX_COUNTERS));
+    size += SessionLog::putVarint(record + size, quint64(count));
+    for (int i = 0; i < count; ++i)
+        size += SessionLog::putVarint(record + size, values[i]);
+    if (append(record, size))
+        previousNanos = timestampNanos;
+}
+
+void SessionRecorder::startFlushing(int intervalMillis)
+{
+    QObject::connect(&flushTimer, &QTimer::timeout, [this]() {
+        if (used > 0)
+            handOver();
+    });
+    flushTimer.start(intervalMillis);
+}
+
+bool SessionRecorder::append(const char *record, int size)
+{
+    if (fd < 0)
+        return false;
+    if (used + size > BUFFER_SIZE && !handOver())
+    {
+        ++droppedCount;
+        return false;
+    }
+    memcpy(buffers[active] + used, record, size);
+    used += size;
+    ++recordCount;
+    return true;
+}
+
+bool SessionRecorder::handOver()
+{
+    {
+        std::lock_guard<std::mutex> lock(writerMutex);
+        if (writing >= 0)
+            return false;
+        writing = active;
+        writingSize = used;
+    }
+    writeWanted.notify_all();
+    active ^= 1;
+    used = 0;
+    return true;
+}
+
+void SessionRecorder::writeLoop()
+{
+    std::unique_lock<std::mutex> lock(writerMutex);
+    for (;;)
+    {
+        writeWanted.wait(lock, [this]() { return writing >= 0 || stopping; });
+        if (writing < 0)
+            return;
+        const char *data = buffers[writing];
+        int remaining = writingSize;
+        lock.unlock();
+        while (remaining > 0)
+        {
+            const ssize_t written = ::write(fd, data, remaining);
+            if (written < 0 && errno == EINTR)
+                continue;
+            if (written <= 0)
+            {
+                qWarning() << "cannot write session recording" << path << strerror(errno);
+                break;
+            }
+            data += written;
+            remaining -= int(written);
+        }
+        lock.lock();
+        writing = -1;
+        writeWanted.notify_all();
+    }
+}
@@ -0,0 +1,68 @@
+#ifndef SESSIONRECORDER_H
+#define SESSIONRECORDER_H
+
+#include <QtCore/qstring.h>
+#include <QtCore/qtimer.h>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// APPENDS EVERY SENSOR EDGE AND EVERY NOTIFICATION PAYLOAD TO A COMPACT BINARY LOG (SEE
+// sessionlog.h) SO COMPLAINTS ABOUT WRONG SPEED CAN BE INVESTIGATED AFTERWARDS.
+//
+// RECORDS ARE ENCODED INTO ONE OF TWO BUFFERS ON THE QT THREAD; A FULL BUFFER IS HANDED
+// TO A WRITER THREAD AND THE OTHER ONE TAKES OVER.  NOTHING HERE EVER WAITS FOR THE DISK:
+// IF THE WRITER HAS NOT FINISHED THE PREVIOUS BUFFER, THE RECORD IS DROPPED AND COUNTED.
+// THE EDGE CAPTURE THREAD IS NOT INVOLVED AT ALL.
+class SessionRecorder
+{
+public:
+    explicit SessionRecorder(const QString &path);
+    ~SessionRecorder();
+
+    // OPENS THE FILE FOR APPENDING AND STARTS A NEW SESSION AT sensorClockNanos (Timebase::now())
+    bool open(qint64 sensorClockNanos);
+    void recordEdge(int pin, qint64 timestampNanos);
+    void recordNotification(quint16 characteristic, qint64 timestampNanos, const char *value, int size);
+    // THE COUNTERS A STATION RESTORED FROM ITS STATE FILE, SO A REPLAY CAN START FROM THEM
+    void recordCounters(quint16 characteristic, int pin, qint64 timestampNanos, const quint32 *values, int count);
+    // WRITES WHAT IS BUFFERED EVERY intervalMillis SO LITTLE IS LOST IF THE PROCESS DIES
+    void startFlushing(int intervalMillis);
+
+    quint64 recorded() const { return recordCount; }
+    quint64 dropped() const { return droppedCount; }
+
+private:
+    enum
+    {
+        BUFFER_SIZE = 64 * 1024
+    };
+
+    bool append(const char *record, int size);
+    // HANDS THE ACTIVE BUFFER TO THE WRITER, FALSE IF IT IS STILL BUSY WITH THE OTHER ONE
+    bool handOver();
+    void writeLoop();
+
+    const QString path;
+    int fd = -1;
+    char buffers[2][BUFFER_SIZE];
+    int active = 0;
+    int used = 0;
+    qint64 previousNanos = 0;
+    quint64 recordCount = 0;
+    quint64 droppedCount = 0;
+    QTimer flushTimer;
+
+    std::thread writer;
+    std::mutex writerMutex;
+    std::condition_variable writeWanted;
+    // BUFFER WAITING FOR OR BEING WRITTEN BY THE WRITER, -1 WHEN IT IS IDLE
+    int writing = -1;
+    int writingSize = 0;
+    bool stopping = false;
+
+    SessionRecorder(const SessionRecorder &) = delete;
+    SessionRecorder &operator=(const SessionRecorder &) = delete;
+};
+
+#endif // SESSIONRECORDER_H
@@ -0,0 +1,148 @@
+#include "simulatedsensorinput.h"
+#include "timebase.h"
+
+#include <QtCore/qfile.h>
+#include <QtCore/qloggingcategory.h>
+#include <QtCore/qstringlist.h>
+#include <cmath>
+
+namespace
+{
+// FRACTION OF A REVOLUTION THE MAGNET HOLDS THE SENSOR HIGH
+const double PULSE_DUTY_CYCLE = 0.25;
+// HOW LONG A REPLAYED EDGE STAYS HIGH, SHORTENED WHEN EDGES ARE CLOSER TOGETHER
+const qint64 TRACE_PULSE_NANOS = 3000000;
+}
+
+SimulatedSensorInput::SimulatedSensorInput(Clock clock)
+    : clock(clock), startNanos(Timebase::now())
+{
+}
+
+void SimulatedSensorInput::setProfile(int pin, const QVector<ProfilePoint> &points)
+{
+    channel(pin).profile = points;
+}
+
+bool SimulatedSensorInput::setProfile(const QString &specification)
+{
+    const int separator = specification.indexOf(QLatin1Char(':'));
+    bool ok = separator > 0;
+    const int pin = specification.left(separator).toInt(&ok);
+    QVector<ProfilePoint> points;
+    for (const QString &point : specification.mid(separator + 1).split(QLatin1Char(',')))
+    {
+        const QStringList parts = point.split(QLatin1Char('@'));
+        bool rpmOk = false;
+        bool secondsOk = true;
+        ProfilePoint profilePoint;
+        profilePoint.rpm = parts.at(0).toDouble(&rpmOk);
+        profilePoint.atNanos = parts.size() > 1 ? qint64(parts.at(1).toDouble(&secondsOk) * 1e9) : 0;
+        ok = ok && rpmOk && secondsOk && parts.size() <= 2;
+        points.append(profilePoint);
+    }
+    if (!ok)
+    {
+        qWarning() << "invalid simulation profile" << specification;
+        return false;
+    }
+    setProfile(pin, points);
+    return true;
+}
+
+bool SimulatedSensorInput::loadTrace(const QString &fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        qWarning() << "cannot open trace" << fileName << file.errorString();
+        return false;
+    }
+    while (!file.atEnd())
+    {
+        const QList<QByteArray> fields = file.readLine().simplified().split(' ');
+        if (fields.size() != 2)
+            continue;
+        bool pinOk = false;
+        bool timeOk = false;
+        const int pin = fields.at(0).toInt(&pinOk);
+        const qint64 micros = fields.at(1).toLongLong(&timeOk);
+        if (pinOk && timeOk)
+            channel(pin).edges.append(micros * 1000);
+    }
+    return true;
+}
+
+void SimulatedSensorInput::configurePin(int pin)
+{
+    channel(pin).lastNanos = now();
+}
+
+int SimulatedSensorInput::read(int pin)
+{
+    Channel &state = channel(pin);
+    const qint64 nanos = now();
+    return state.edges.isEmpty() ? readProfile(state, nanos) : readTrace(state, nanos);
+}
+
+qint64 SimulatedSensorInput::now()
+{
+    return clock == ManualClock ? manualNanos : Timebase::now() - startNanos;
+}
+
+SimulatedSensorInput::Channel &SimulatedSensorInput::channel(int pin)
+{
+    for (Channel &existing : channels)
+    {
+        if (existing.pin == pin)
+            return existing;
+    }
+    Channel added;
+    added.pin = pin;
+    channels.append(added);
+    return channels.last();
+}
+
+double SimulatedSensorInput::rpmAt(const Channel &channel, qint64 nanos) const
+{
+    const QVector<ProfilePoint> &profile = channel.profile;
+    if (profile.isEmpty())
+        return 0;
+    if (nanos <= profile.first().atNanos)
+        return profile.first().rpm;
+    for (int i = 1; i < profile.size(); ++i)
+    {
+        if (nanos < profile.at(i).atNanos)
+        {
+            const ProfilePoint &from = profile.at(i - 1);
+            const ProfilePoint &to = profile.at(i);
+            return from.rpm + (to.rpm - from.rpm) * double(nanos - from.atNanos) / double(to.atNanos - from.atNanos);
+        }
+    }
+    return profile.last().rpm;
+}
+
+int SimulatedSensorInput::readProfile(Channel &channel, qint64 nanos)
+{
+    // INTEGRATE REVOLUTIONS SINCE THE LAST READ WITH THE TRAPEZOID RULE
+    const double averageRpm = (rpmAt(channel, channel.lastNanos) + rpmAt(channel, nanos)) / 2;
+    channel.phase += averageRpm * double(nanos - channel.lastNanos) / 60e9;
+    channel.phase -= std::floor(channel.phase);
+    channel.lastNanos = nanos;
+    // the sensor goes high as the magnet arrives, so a revolution starts with the pulse
+    return channel.phase < PULSE_DUTY_CYCLE ? 1 : 0;
+}
+
+int SimulatedSensorInput::readTrace(Channel &channel, qint64 nanos)
+{
+    const QVector<qint64> &edges = channel.edges;
+    while (channel.nextEdge < edges.size() && edges.at(channel.nextEdge) <= nanos)
+        ++channel.nextEdge;
+    if (channel.nextEdge == 0)
+        return 0;
+    const qint64 edge = edges.at(channel.nextEdge - 1);
+    qint64 pulse = TRACE_PULSE_NANOS;
+    if (channel.nextEdge < edges.size())
+        pulse = qMin(pulse, (edges.at(channel.nextEdge) - edge) / 2);
+    return nanos - edge < pulse ? 1 : 0;
+}
@@ -0,0 +1,62 @@
+#ifndef SIMULATEDSENSORINPUT_H
+#define SIMULATEDSENSORINPUT_H
+
+#include "sensorinput.h"
+
+#include <QtCore/qstring.h>
+#include <QtCore/qvector.h>
+
+// GENERATES HALL SENSOR LEVELS FROM AN RPM PROFILE OR REPLAYS A TRACE OF EDGE TIMESTAMPS.
+// WITH THE MANUAL CLOCK TIME ONLY MOVES WHEN advance() IS CALLED, SO A BENCHMARK CAN
+// DRIVE THE SAMPLING PATH AT ANY SIMULATED RPM AS FAST AS THE CPU ALLOWS.
+class SimulatedSensorInput : public SensorInput
+{
+public:
+    enum Clock
+    {
+        RealTimeClock,
+        ManualClock
+    };
+    struct ProfilePoint
+    {
+        qint64 atNanos;
+        double rpm;
+    };
+
+    explicit SimulatedSensorInput(Clock clock = RealTimeClock);
+
+    // RPM IS INTERPOLATED LINEARLY BETWEEN POINTS AND HELD AFTER THE LAST ONE
+    void setProfile(int pin, const QVector<ProfilePoint> &points);
+    // "PIN:RPM[@SECONDS],RPM@SECONDS,..."
+    bool setProfile(const QString &specification);
+    // ONE RISING EDGE PER LINE: "PIN MICROSECONDS"
+    bool loadTrace(const QString &fileName);
+    void advance(qint64 nanos) { manualNanos += nanos; }
+
+    void configurePin(int pin) override;
+    int read(int pin) override;
+    qint64 now() override;
+
+private:
+    struct Channel
+    {
+        int pin;
+        QVector<ProfilePoint> profile;
+        QVector<qint64> edges;
+        int nextEdge = 0;
+        double phase = 0;
+        qint64 lastNanos = 0;
+    };
+
+    Channel &channel(int pin);
+    double rpmAt(const Channel &channel, qint64 nanos) const;
+    int readProfile(Channel &channel, qint64 nanos);
+    int readTrace(Channel &channel, qint64 nanos);
+
+    const Clock clock;
+    const qint64 startNanos;
+    qint64 manualNanos = 0;
+    QVector<Channel> channels;
+};
+
+#endif // SIMULATEDSENSORINPUT_H
@@ -0,0 +1,64 @@
+#include "speedestimator.h"
+
+SpeedEstimator::SpeedEstimator(int distancePerRevolution, const Settings &estimatorSettings)
+    : distancePerRevolution(distancePerRevolution), settings(estimatorSettings)
+{
+    settings.windowEdges = qBound(2, settings.windowEdges, int(MAX_WINDOW_EDGES));
+    settings.smoothing = qBound(1, settings.smoothing, 256);
+}
+
+void SpeedEstimator::addEdge(qint64 timestampNanos)
+{
+    // A FULL WINDOW DROPS ITS OLDEST EDGE, THEN EDGES TOO OLD FOR THE WINDOW GO AS WELL
+    if (count == settings.windowEdges)
+    {
+        first = (first + 1) % MAX_WINDOW_EDGES;
+        --count;
+    }
+    edges[(first + count) % MAX_WINDOW_EDGES] = timestampNanos;
+    ++count;
+    predictedSpeed = std::numeric_limits<qint64>::max();
+    while (count > 2 && timestampNanos - edges[first] > settings.windowNanos)
+    {
+        first = (first + 1) % MAX_WINDOW_EDGES;
+        --count;
+    }
+    if (count < 2)
+        return;
+
+    const qint64 span = timestampNanos - edges[first];
+    if (span <= 0)
+        return;
+    // MILLIMETERS PER MILLISECOND ARE METERS PER SECOND, SCALED TO 1/65536 M/S
+    const qint64 windowSpeed = qint64(count - 1) * distancePerRevolution * 65536 * 1000000 / span;
+    smoothedSpeed += (windowSpeed - smoothedSpeed) * settings.smoothing / 256;
+}
+
+void SpeedEstimator::update(qint64 nowNanos)
+{
+    if (!count)
+        return;
+    const qint64 sinceEdge = nowNanos - edges[newest()];
+    if (sinceEdge > settings.stopTimeoutNanos)
+    {
+        reset();
+        return;
+    }
+    if (settings.stopPeriods <= 0 || count < 2 || sinceEdge <= 0)
+        return;
+    const qint64 period = edges[newest()] - edges[(first + count - 2) % MAX_WINDOW_EDGES];
+    if (sinceEdge > period * settings.stopPeriods)
+    {
+        reset();
+        return;
+    }
+    predictedSpeed = distancePerRevolution * 65536 * 1000000 / sinceEdge;
+}
+
+void SpeedEstimator::reset()
+{
+    first = 0;
+    count = 0;
+    smoothedSpeed = 0;
+    predictedSpeed = std::numeric_limits<qint64>::max();
+}
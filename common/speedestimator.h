@@ -0,0 +1,64 @@
+#ifndef SPEEDESTIMATOR_H
+#define SPEEDESTIMATOR_H
+
+#include <QtCore/qglobal.h>
+#include <limits>
+
+// STREAMING SPEED FROM EDGE TIMESTAMPS OVER A SLIDING WINDOW.  EACH EDGE IS O(1): THE WINDOW
+// IS A RING OF THE LAST EDGES, TRIMMED TO A MAXIMUM AGE, AND SPEED IS (EDGES IN WINDOW - 1)
+// REVOLUTIONS OVER THE TIME THEY SPAN.  ALL MATHS IS INTEGER, IN THE 1/256 M/S UNITS OF THE RSC
+// MEASUREMENT, WITH AN OPTIONAL EXPONENTIAL SMOOTHING STEP.
+//
+// BETWEEN EDGES THE SPEED IS PREDICTED FROM THE TIME SINCE THE LAST ONE: WITH NO EDGE FOR T
+// THE BELT CANNOT HAVE MOVED A WHOLE REVOLUTION, SO IT IS NOW SLOWER THAN DISTANCE / T AND
+// THE SPEED DECAYS TOWARDS ZERO INSTEAD OF HOLDING THE LAST WINDOW.  A FEW MISSED EDGE
+// PERIODS ARE A STOP, WHICH AT LOW SPEED COMES LONG BEFORE THE FIXED TIMEOUT.
+class SpeedEstimator
+{
+public:
+    enum
+    {
+        MAX_WINDOW_EDGES = 64
+    };
+    struct Settings
+    {
+        // EDGES OLDER THAN THIS FALL OUT OF THE WINDOW
+        qint64 windowNanos = 2000000000;
+        // AND NEVER MORE THAN THIS MANY EDGES, UP TO MAX_WINDOW_EDGES
+        int windowEdges = 8;
+        // WEIGHT OF THE NEWEST WINDOW SPEED IN 1/256, 256 TURNS SMOOTHING OFF
+        int smoothing = 128;
+        // NO EDGE FOR THIS LONG MEANS STOPPED
+        qint64 stopTimeoutNanos = 2000000000;
+        // NO EDGE FOR THIS MANY OF THE LAST EDGE PERIODS MEANS STOPPED AS WELL, 0 TURNS
+        // PREDICTION OFF AND HOLDS THE WINDOW SPEED UNTIL THE TIMEOUT
+        int stopPeriods = 4;
+    };
+
+    // DISTANCE TRAVELLED PER EDGE IN MILLIMETERS
+    SpeedEstimator(int distancePerRevolution, const Settings &settings);
+
+    void addEdge(qint64 timestampNanos);
+    // CHECKS FOR A STOP AND PREDICTS THE SPEED SINCE THE LAST EDGE, CALL BEFORE READING IT
+    void update(qint64 nowNanos);
+    // 1/256 M/S
+    quint16 speed() const { return quint16((qMin(smoothedSpeed, predictedSpeed) + 128) >> 8); }
+    qint64 lastEdgeNanos() const { return count ? edges[newest()] : -1; }
+
+    void reset();
+
+private:
+    int newest() const { return (first + count - 1) % MAX_WINDOW_EDGES; }
+
+    const qint64 distancePerRevolution;
+    Settings settings;
+    qint64 edges[MAX_WINDOW_EDGES];
+    int first = 0;
+    int count = 0;
+    // 1/65536 M/S SO THE SMOOTHING KEEPS ITS FRACTION
+    qint64 smoothedSpeed = 0;
+    // UPPER BOUND FROM THE TIME SINCE THE LAST EDGE, SAME UNITS
+    qint64 predictedSpeed = std::numeric_limits<qint64>::max();
+};
+
+#endif // SPEEDESTIMATOR_H
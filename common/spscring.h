@@ -0,0 +1,64 @@
+#ifndef SPSCRING_H
+#define SPSCRING_H
+
+#include <QtCore/qglobal.h>
+#include <atomic>
+
+// SINGLE PRODUCER / SINGLE CONSUMER LOCK-FREE RING.  ONE THREAD PUSHES, ONE THREAD POPS,
+// NEITHER EVER BLOCKS.  A PUSH INTO A FULL RING IS DROPPED AND COUNTED AS AN OVERFLOW.
+template <typename T, int Capacity>
+class SpscRing
+{
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "capacity must be a power of two");
+
+public:
+    // producer side
+    bool push(const T &value)
+    {
+        const quint32 head = writeIndex.load(std::memory_order_relaxed);
+        const quint32 used = head - readIndex.load(std::memory_order_acquire);
+        if (used == quint32(Capacity))
+        {
+            overflowCount.store(overflowCount.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return false;
+        }
+        slots[head & (Capacity - 1)] = value;
+        writeIndex.store(head + 1, std::memory_order_release);
+        if (used + 1 > highWater.load(std::memory_order_relaxed))
+            highWater.store(used + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // consumer side, returns how many values were copied into out
+    int pop(T *out, int maxCount)
+    {
+        const quint32 tail = readIndex.load(std::memory_order_relaxed);
+        const quint32 available = writeIndex.load(std::memory_order_acquire) - tail;
+        const int count = available < quint32(maxCount) ? int(available) : maxCount;
+        for (int i = 0; i < count; ++i)
+            out[i] = slots[(tail + quint32(i)) & (Capacity - 1)];
+        readIndex.store(tail + quint32(count), std::memory_order_release);
+        return count;
+    }
+
+    static int capacity() { return Capacity; }
+    quint64 overflows() const { return overflowCount.load(std::memory_order_relaxed); }
+    int highWaterMark() const { return int(highWater.load(std::memory_order_relaxed)); }
+
+private:
+    // keep the producer and consumer indices on separate cache lines.  padding rather than
+    // alignas so the ring can live in heap objects without c++17 aligned new
+    enum
+    {
+        CACHE_LINE = 64
+    };
+    std::atomic<quint32> writeIndex{0};
+    std::atomic<quint64> overflowCount{0};
+    std::atomic<quint32> highWater{0};
+    char producerPadding[CACHE_LINE];
+    std::atomic<quint32> readIndex{0};
+    char consumerPadding[CACHE_LINE];
+    T slots[Capacity];
+};
+
+#endif // SPSCRING_H
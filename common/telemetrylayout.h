@@ -0,0 +1,87 @@
+#ifndef TELEMETRYLAYOUT_H
+#define TELEMETRYLAYOUT_H
+
+#include <QtCore/qglobal.h>
+#include <atomic>
+
+// LAYOUT OF THE SHARED-MEMORY TELEMETRY FEED, SHARED BY THE PUBLISHER AND THE READER.
+//
+// THE SEGMENT IS A HEADER FOLLOWED BY ONE SLOT PER STATION.  EACH SLOT IS GUARDED BY A
+// SEQLOCK: THE DAEMON (THE ONLY WRITER) MAKES THE SEQUENCE ODD, WRITES THE VALUES AND MAKES
+// IT EVEN AGAIN.  A READER COPIES THE VALUES BETWEEN TWO READS OF THE SEQUENCE AND RETRIES
+// WHEN IT WAS ODD OR HAS MOVED, SO READERS NEVER BLOCK THE WRITER OR EACH OTHER AND NEED NO
+// SYSCALL ONCE THE SEGMENT IS MAPPED.  SLOTS ARE A CACHE LINE MULTIPLE SO A READER POLLING
+// ONE STATION DOES NOT BOUNCE THE LINE OF ANOTHER.
+namespace Telemetry
+{
+enum
+{
+    VERSION = 1,
+    MAX_STATIONS = 16,
+    LABEL_SIZE = 24,
+    CACHE_LINE = 64
+};
+// "BTTM" IN THE FIRST FOUR BYTES OF THE SEGMENT
+const quint32 MAGIC = 0x4d545442;
+
+enum Kind
+{
+    Cycling = 1,
+    Running = 2,
+    Treadmill = 3
+};
+
+struct Values
+{
+    // SENSOR CLOCK OF THE DAEMON (CLOCK_MONOTONIC_RAW ON HARDWARE) AT THE UPDATE, 0 BEFORE THE FIRST
+    qint64 updatedNanos;
+    // CYCLING: WHEEL AND CRANK.  RUNNING AND TREADMILL: THE BELT, AS WHEEL
+    quint32 wheelRevolutions;
+    quint32 crankRevolutions;
+    // SENSOR CLOCK TIMESTAMPS OF THE LATEST EDGES, -1 BEFORE THE FIRST
+    qint64 lastWheelEdgeNanos;
+    qint64 lastCrankEdgeNanos;
+    // CSC EVENT TIMES IN 1/1024 S, AS NOTIFIED
+    quint16 lastWheelEventTime;
+    quint16 lastCrankEventTime;
+    // 1/256 M/S, RUNNING AND TREADMILL ONLY
+    quint16 speed;
+    // CRANK RPM (CYCLING) OR STEPS PER MINUTE (RUNNING)
+    quint16 cadence;
+    // 1/100 RPM OF THE WHEEL OR BELT
+    quint32 wheelRpm;
+    // 1/10 M, RUNNING AND TREADMILL ONLY
+    quint32 totalDistance;
+};
+
+struct Slot
+{
+    // ODD WHILE THE VALUES ARE BEING WRITTEN
+    std::atomic<quint32> sequence;
+    // Kind, 0 FOR AN UNUSED SLOT
+    quint32 kind;
+    // NUL TERMINATED SERVICE LABEL, E.G. "csc0"
+    char label[LABEL_SIZE];
+    Values values;
+    char padding[(CACHE_LINE - (8 + LABEL_SIZE + sizeof(Values)) % CACHE_LINE) % CACHE_LINE];
+};
+
+struct Header
+{
+    quint32 magic;
+    quint32 version;
+    quint32 slotSize;
+    quint32 stations;
+    char padding[CACHE_LINE - 16];
+};
+
+struct Segment
+{
+    Header header;
+    Slot slots[MAX_STATIONS];
+};
+
+static_assert(sizeof(Slot) % CACHE_LINE == 0, "slots must not share cache lines");
+}
+
+#endif // TELEMETRYLAYOUT_H
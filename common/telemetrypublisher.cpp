@@ -0,0 +1,80 @@
+#include "telemetrypublisher.h"
+
+#include <QtCore/qloggingcategory.h>
+#include <cstring>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+TelemetryPublisher::TelemetryPublisher(const QString &name)
+    : name(name)
+{
+}
+
+TelemetryPublisher::~TelemetryPublisher()
+{
+    if (!segment)
+        return;
+    // READERS THAT STILL HAVE IT MAPPED KEEP THEIR COPY, NEW ONES FIND NOTHING
+    munmap(segment, sizeof(Telemetry::Segment));
+    ::close(fd);
+    shm_unlink(name.toLocal8Bit().constData());
+}
+
+bool TelemetryPublisher::open(int stations)
+{
+    static_assert(ATOMIC_INT_LOCK_FREE == 2, "readers in other processes need a lock-free sequence");
+    if (stations > Telemetry::MAX_STATIONS)
+    {
+        qWarning() << "telemetry has room for" << Telemetry::MAX_STATIONS << "stations, not" << stations;
+        return false;
+    }
+    fd = shm_open(name.toLocal8Bit().constData(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+        qWarning() << "cannot open telemetry segment" << name << strerror(errno);
+        return false;
+    }
+    if (ftruncate(fd, sizeof(Telemetry::Segment)) != 0
+        || (segment = static_cast<Telemetry::Segment *>(mmap(nullptr, sizeof(Telemetry::Segment), PROT_READ | PROT_WRITE,
+                                                             MAP_SHARED, fd, 0))) == MAP_FAILED)
+    {
+        qWarning() << "cannot map telemetry segment" << name << strerror(errno);
+        segment = nullptr;
+        ::close(fd);
+        fd = -1;
+        return false;
+    }
+
+    // A SEGMENT LEFT BEHIND BY A CRASHED DAEMON IS WIPED; READERS IGNORE IT UNTIL THE MAGIC
+    // IS BACK, WHICH IS WRITTEN LAST
+    Telemetry::Header &header = segment->header;
+    header.magic = 0;
+    std::atomic_thread_fence(std::memory_order_release);
+    for (Telemetry::Slot &slot : segment->slots)
+    {
+        slot.sequence.store(0, std::memory_order_relaxed);
+        slot.kind = 0;
+        memset(slot.label, 0, sizeof(slot.label));
+        memset(&slot.values, 0, sizeof(slot.values));
+        slot.values.lastWheelEdgeNanos = -1;
+        slot.values.lastCrankEdgeNanos = -1;
+    }
+    header.version = Telemetry::VERSION;
+    header.slotSize = sizeof(Telemetry::Slot);
+    header.stations = quint32(stations);
+    std::atomic_thread_fence(std::memory_order_release);
+    header.magic = Telemetry::MAGIC;
+    return true;
+}
+
+void TelemetryPublisher::setStation(int station, Telemetry::Kind kind, const QString &label)
+{
+    Telemetry::Slot &slot = segment->slots[station];
+    const QByteArray bytes = label.toUtf8().left(Telemetry::LABEL_SIZE - 1);
+    memset(slot.label, 0, sizeof(slot.label));
+    memcpy(slot.label, bytes.constData(), size_t(bytes.size()));
+    slot.kind = quint32(kind);
+}
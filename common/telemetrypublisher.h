@@ -0,0 +1,43 @@
+#ifndef TELEMETRYPUBLISHER_H
+#define TELEMETRYPUBLISHER_H
+
+#include "telemetrylayout.h"
+
+#include <QtCore/qstring.h>
+
+// PUBLISHES THE LATEST VALUES OF EVERY STATION INTO A POSIX SHARED-MEMORY SEGMENT (SEE
+// telemetrylayout.h) FOR DASHBOARDS AND LOGGERS ON THE SAME DEVICE, SO THEY DO NOT HAVE TO
+// PAIR OVER BLUETOOTH AND COMPETE WITH THE REAL CENTRAL FOR THE LINK.
+//
+// AN UPDATE IS A FEW PLAIN STORES ON THE QT THREAD, BETWEEN TWO SEQUENCE STORES: NO LOCK, NO
+// SYSCALL, AND NOTHING A READER DOES CAN DELAY IT.  THE SEGMENT IS REMOVED AGAIN ON EXIT.
+class TelemetryPublisher
+{
+public:
+    // A SHARED-MEMORY NAME SUCH AS /bluetooth-sensors
+    explicit TelemetryPublisher(const QString &name);
+    ~TelemetryPublisher();
+
+    // CREATES OR TAKES OVER THE SEGMENT, WITH stations EMPTY SLOTS
+    bool open(int stations);
+    void setStation(int station, Telemetry::Kind kind, const QString &label);
+    void publish(int station, const Telemetry::Values &values)
+    {
+        Telemetry::Slot &slot = segment->slots[station];
+        const quint32 sequence = slot.sequence.load(std::memory_order_relaxed);
+        slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.values = values;
+        slot.sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+private:
+    const QString name;
+    int fd = -1;
+    Telemetry::Segment *segment = nullptr;
+
+    TelemetryPublisher(const TelemetryPublisher &) = delete;
+    TelemetryPublisher &operator=(const TelemetryPublisher &) = delete;
+};
+
+#endif // TELEMETRYPUBLISHER_H
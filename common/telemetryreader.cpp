@@ -0,0 +1,65 @@
+#include "telemetryreader.h"
+
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace
+{
+// AN UPDATE IS A HANDFUL OF STORES, SO THIS MANY COLLISIONS IN A ROW ONLY HAPPEN WHEN THE
+// WRITER IS GONE
+const int MAX_ATTEMPTS = 10000;
+}
+
+TelemetryReader::~TelemetryReader()
+{
+    close();
+}
+
+bool TelemetryReader::open(const char *name)
+{
+    close();
+    const int fd = shm_open(name, O_RDONLY | O_CLOEXEC, 0);
+    if (fd < 0)
+        return false;
+    void *mapped = mmap(nullptr, sizeof(Telemetry::Segment), PROT_READ, MAP_SHARED, fd, 0);
+    // THE MAPPING KEEPS THE SEGMENT, THE DESCRIPTOR IS NOT NEEDED ANY MORE
+    ::close(fd);
+    if (mapped == MAP_FAILED)
+        return false;
+    segment = static_cast<const Telemetry::Segment *>(mapped);
+    const Telemetry::Header &header = segment->header;
+    const bool ready = header.magic == Telemetry::MAGIC;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (!ready || header.version != Telemetry::VERSION || header.slotSize != sizeof(Telemetry::Slot)
+        || header.stations > Telemetry::MAX_STATIONS)
+    {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void TelemetryReader::close()
+{
+    if (segment)
+        munmap(const_cast<Telemetry::Segment *>(segment), sizeof(Telemetry::Segment));
+    segment = nullptr;
+}
+
+bool TelemetryReader::read(int station, Telemetry::Values *values) const
+{
+    const Telemetry::Slot &slot = segment->slots[station];
+    for (int attempt = 0; attempt < MAX_ATTEMPTS; ++attempt)
+    {
+        const quint32 before = slot.sequence.load(std::memory_order_acquire);
+        if (before & 1)
+            continue;
+        memcpy(values, &slot.values, sizeof(*values));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) == before)
+            return true;
+    }
+    return false;
+}
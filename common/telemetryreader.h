@@ -0,0 +1,36 @@
+#ifndef TELEMETRYREADER_H
+#define TELEMETRYREADER_H
+
+#include "telemetrylayout.h"
+
+// READS THE DAEMON'S SHARED-MEMORY TELEMETRY (SEE telemetrylayout.h).  ONLY open() AND THE
+// DESTRUCTOR MAKE SYSCALLS; read() IS A FEW LOADS AND A COPY, SO A DASHBOARD CAN POLL IT AS
+// OFTEN AS IT REDRAWS.  ANY NUMBER OF READERS CAN RUN AT ONCE, THE DAEMON NEVER WAITS FOR
+// THEM.  NEEDS NOTHING BUT QtCore's HEADERS, SO IT CAN BE COPIED INTO OTHER PROJECTS.
+class TelemetryReader
+{
+public:
+    TelemetryReader() = default;
+    ~TelemetryReader();
+
+    // MAPS THE SEGMENT READ-ONLY.  FALSE WHILE THE DAEMON IS NOT RUNNING OR HAS NOT FINISHED
+    // SETTING IT UP, OR WHEN IT WAS WRITTEN BY AN INCOMPATIBLE VERSION; TRY AGAIN LATER
+    bool open(const char *name);
+    void close();
+    bool isOpen() const { return segment != nullptr; }
+
+    int stations() const { return segment ? int(segment->header.stations) : 0; }
+    Telemetry::Kind kind(int station) const { return Telemetry::Kind(segment->slots[station].kind); }
+    const char *label(int station) const { return segment->slots[station].label; }
+    // A CONSISTENT COPY OF THE LATEST VALUES.  FALSE ONLY IF EVERY ATTEMPT RAN INTO AN UPDATE,
+    // WHICH MEANS THE DAEMON DIED IN THE MIDDLE OF ONE
+    bool read(int station, Telemetry::Values *values) const;
+
+private:
+    const Telemetry::Segment *segment = nullptr;
+
+    TelemetryReader(const TelemetryReader &) = delete;
+    TelemetryReader &operator=(const TelemetryReader &) = delete;
+};
+
+#endif // TELEMETRYREADER_H
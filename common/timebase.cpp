@@ -0,0 +1,41 @@
+#include "timebase.h"
+
+#include <time.h>
+
+namespace
+{
+Timebase::Source fakeSource = nullptr;
+
+qint64 clockNanos(clockid_t clock)
+{
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return qint64(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+}
+
+qint64 Timebase::now()
+{
+    return fakeSource ? fakeSource() : clockNanos(CLOCK_MONOTONIC_RAW);
+}
+
+void Timebase::setSource(Source fake)
+{
+    fakeSource = fake;
+}
+
+qint64 Timebase::fromMonotonic(qint64 monotonicNanos)
+{
+    // THE TWO CLOCKS ONLY DRIFT APART AT THE SLEW RATE, SO THE DIFFERENCE NOW IS THE
+    // DIFFERENCE AT AN EVENT A FEW MILLISECONDS AGO TO WELL UNDER A MICROSECOND.  A FAKE
+    // SOURCE HAS NO RELATION TO CLOCK_MONOTONIC, SO ONLY THE EVENT'S AGE CARRIES OVER TO IT
+    const qint64 age = clockNanos(CLOCK_MONOTONIC) - monotonicNanos;
+    return now() - age;
+}
+
+void Timebase::EventTimeCounter::restart(qint64 nanos)
+{
+    last = nanos;
+    ticks = quint64(nanos) * 2 / TICK_HALF_NANOS;
+    remainder = quint32(quint64(nanos) * 2 % TICK_HALF_NANOS);
+}
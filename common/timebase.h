@@ -0,0 +1,68 @@
+#ifndef TIMEBASE_H
+#define TIMEBASE_H
+
+#include <QtCore/qglobal.h>
+
+// THE SENSOR CLOCK.  EDGE TIMESTAMPS, THE SPEED MATHS AND THE EVENT TIMES CLIENTS SEE ALL
+// COME FROM CLOCK_MONOTONIC_RAW, READ ONCE PER SAMPLE.  CLOCK_MONOTONIC NEVER STEPS, BUT WHILE
+// NTP CORRECTS IT (OR AFTER A BOOT WITH A WRONG RTC) IT IS SLEWED BY UP TO 500 PPM, WHICH
+// SHOWS UP AS SPEED AND EVENT TIMES DRIFTING AGAINST THE CENTRAL'S OWN CLOCK.  THE RAW CLOCK
+// TICKS AT THE CRYSTAL'S RATE WHATEVER NTP DOES.
+//
+// KERNEL GPIO EVENTS AND clock_nanosleep() ONLY KNOW CLOCK_MONOTONIC, SO SLEEPS STAY ON IT AND
+// EVENT TIMESTAMPS ARE MOVED ONTO THE RAW CLOCK WITH fromMonotonic().
+namespace Timebase
+{
+typedef qint64 (*Source)();
+
+// NANOSECONDS, FROM THE FAKE SOURCE WHILE ONE IS SET
+qint64 now();
+// TEST HOOK: EVERY SENSOR TIMESTAMP COMES FROM fake UNTIL IT IS SET BACK TO NULL.  SET IT
+// BEFORE ANY CAPTURE THREAD STARTS
+void setSource(Source fake);
+// A CLOCK_MONOTONIC TIMESTAMP OF THE RECENT PAST ON THE SENSOR CLOCK: now() LESS HOW LONG AGO
+// IT WAS.  WITH A FAKE SOURCE THAT AGE IS STILL MEASURED ON THE REAL CLOCK, SO KERNEL EDGE
+// EVENTS LAND ON THE FAKE TIMELINE BUT ARE ONLY AS REPEATABLE AS THE KERNEL'S DELIVERY
+qint64 fromMonotonic(qint64 monotonicNanos);
+
+// CSC EVENT TIMES (1/1024 S, WRAPPING EVERY 64 S) OF A STREAM OF TIMESTAMPS, CARRIED OVER
+// FROM THE PREVIOUS ONE.  THE RESULT IS EXACTLY MeasurementEncoding::eventTime(), BUT A STEP
+// OF LESS THAN A SECOND IS ONE 32 BIT DIVISION BY A CONSTANT (A MULTIPLY) INSTEAD OF A 64 BIT
+// ONE, WHICH 32 BIT ARM BUILDS DO IN A LIBRARY CALL.  LONGER OR BACKWARD STEPS START OVER.
+class EventTimeCounter
+{
+public:
+    quint16 at(qint64 nanos)
+    {
+        const qint64 step = nanos - last;
+        if (quint64(step) >= MAX_STEP_NANOS)
+        {
+            restart(nanos);
+            return quint16(ticks);
+        }
+        last = nanos;
+        // 1024 / 10^9 == 2 / 1953125, SO THE REMAINDER IS KEPT IN 1/2 NANOSECONDS
+        const quint32 sum = remainder + quint32(step) * 2;
+        const quint32 carry = sum / TICK_HALF_NANOS;
+        remainder = sum - carry * TICK_HALF_NANOS;
+        ticks += carry;
+        return quint16(ticks);
+    }
+
+private:
+    enum : quint32
+    {
+        TICK_HALF_NANOS = 1953125,
+        // remainder + 2 * step STAYS BELOW 2^32
+        MAX_STEP_NANOS = 1u << 30
+    };
+
+    void restart(qint64 nanos);
+
+    qint64 last = 0;
+    quint32 remainder = 0;
+    quint64 ticks = 0;
+};
+}
+
+#endif // TIMEBASE_H
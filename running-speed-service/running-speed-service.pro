@@ -6,6 +6,7 @@ CONFIG += c++11
 
 SOURCES += main.cpp
 
-LIBS += -lwiringPi
+include(../common/common.pri)
+
 target.path = .
 INSTALLS += target
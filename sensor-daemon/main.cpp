@@ -0,0 +1,11 @@
+#include "sensordaemon.h"
+
+int main(int argc, char *argv[])
+{
+    // PICK THE HOSTED SERVICES WITH --profiles, E.G. --profiles speed,cadence,running
+    SensorDaemon::Defaults defaults;
+    defaults.name = "Berkstresser_Sensor";
+    defaults.profiles = "speed,cadence";
+    defaults.pollingInterval = 2;
+    return SensorDaemon::run(argc, argv, defaults);
+}
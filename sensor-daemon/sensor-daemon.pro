@@ -0,0 +1,12 @@
+TEMPLATE = app
+TARGET = sensor-daemon.bin
+
+QT = core bluetooth
+CONFIG += c++11
+
+SOURCES += main.cpp
+
+include(../common/common.pri)
+
+target.path = .
+INSTALLS += target
@@ -0,0 +1,219 @@
+#include "sessionanalyzer.h"
+
+#include <QtCore/qcommandlineparser.h>
+#include <QtCore/qcoreapplication.h>
+#include <QtCore/qdir.h>
+#include <QtCore/qfile.h>
+#include <QtCore/qfileinfo.h>
+#include <QtCore/qloggingcategory.h>
+#include <QtCore/qstringlist.h>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <sys/mman.h>
+#include <thread>
+#include <vector>
+
+namespace
+{
+// THE DAEMON'S DEFAULTS, SO A RECORDING OF AN UNTUNED DAEMON NEEDS NO OPTIONS BUT THE STATIONS
+const int DISTANCE_PER_REVOLUTION = 133;
+
+int intValue(const QCommandLineParser &parser, const char *name, bool *ok)
+{
+    bool valid = false;
+    const int value = parser.value(QLatin1String(name)).toInt(&valid);
+    if (!valid)
+    {
+        qWarning() << "invalid value for --" << name;
+        *ok = false;
+    }
+    return value;
+}
+
+double doubleValue(const QCommandLineParser &parser, const char *name, bool *ok)
+{
+    bool valid = false;
+    const double value = parser.value(QLatin1String(name)).toDouble(&valid);
+    if (!valid)
+    {
+        qWarning() << "invalid value for --" << name;
+        *ok = false;
+    }
+    return value;
+}
+
+bool parseSettings(const QCommandLineParser &parser, SessionAnalyzer::Settings *settings)
+{
+    if (!parser.isSet(QStringLiteral("station")))
+    {
+        qWarning() << "--station is needed, as given to the daemon";
+        return false;
+    }
+    for (const QString &specification : parser.values(QStringLiteral("station")))
+    {
+        SessionAnalyzer::Station station;
+        if (!SessionAnalyzer::parseStation(specification, &station))
+        {
+            qWarning() << "invalid --station" << specification;
+            return false;
+        }
+        settings->stations << station;
+    }
+
+    bool ok = true;
+    settings->distancePerRevolution = intValue(parser, "distance-per-revolution", &ok);
+    if (settings->distancePerRevolution <= 0)
+    {
+        qWarning() << "--distance-per-revolution must be positive";
+        ok = false;
+    }
+    settings->speed.windowNanos = qint64(intValue(parser, "speed-window", &ok)) * 1000000;
+    settings->speed.windowEdges = intValue(parser, "speed-window-edges", &ok);
+    const double smoothing = doubleValue(parser, "speed-smoothing", &ok);
+    if (smoothing <= 0 || smoothing > 1)
+    {
+        qWarning() << "invalid value for --speed-smoothing";
+        ok = false;
+    }
+    settings->speed.smoothing = qRound(smoothing * 256);
+    settings->speed.stopPeriods = intValue(parser, "speed-stop-periods", &ok);
+    settings->estimateCadence = parser.isSet(QStringLiteral("estimate-cadence"));
+    settings->scheduling.coalesceWindowMillis = intValue(parser, "coalesce-window", &ok);
+    settings->scheduling.keepAliveMillis = intValue(parser, "keep-alive", &ok);
+    settings->maxRpm = intValue(parser, "anomaly-rpm", &ok);
+    settings->jumpFactor = doubleValue(parser, "jump-factor", &ok);
+    settings->jumpMinRpm = intValue(parser, "jump-min-rpm", &ok);
+    settings->gapNanos = qint64(intValue(parser, "gap", &ok)) * 1000000;
+    settings->maxListedAnomalies = intValue(parser, "list-anomalies", &ok);
+    return ok;
+}
+
+// THE REPORT OF ONE RECORDING, WRITTEN BY WHICHEVER WORKER TOOK IT
+struct Result
+{
+    char *report = nullptr;
+    size_t size = 0;
+    bool complete = false;
+};
+
+Result analyzeFile(const SessionAnalyzer &analyzer, const QString &path, const QString &notificationDirectory)
+{
+    Result result;
+    FILE *report = open_memstream(&result.report, &result.size);
+    QFile file(path);
+    if (!report)
+        return result;
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        fprintf(report, "%s: cannot open: %s\n", path.toLocal8Bit().constData(), file.errorString().toLocal8Bit().constData());
+        fclose(report);
+        return result;
+    }
+    const QString notifications =
+        notificationDirectory.isEmpty() ? QString() : QDir(notificationDirectory).filePath(QFileInfo(path).fileName());
+
+    // MAPPED, THE READER PARSES THE PAGE CACHE IN PLACE AND THE KERNEL READS AHEAD
+    const qint64 size = file.size();
+    uchar *mapped = size > 0 ? file.map(0, size) : nullptr;
+    if (mapped)
+    {
+        madvise(mapped, size_t(size), MADV_SEQUENTIAL);
+        result.complete = analyzer.analyze(reinterpret_cast<const char *>(mapped), size, path, report, notifications);
+        file.unmap(mapped);
+    }
+    else
+    {
+        const QByteArray contents = file.readAll();
+        result.complete = analyzer.analyze(contents.constData(), contents.size(), path, report, notifications);
+    }
+    fclose(report);
+    return result;
+}
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Replays session recordings through the CSC, RSC and FTMS services: summary, anomalies and "
+                                     "the notifications a subscribed central would have got, one recording per CPU at a time.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("recordings", "Session recordings written with --record.", "recording...");
+    parser.addOption(QCommandLineOption("station", "A station of the recording daemon, repeat for more: speed:PIN, cadence:PIN, speed-cadence:WHEEL:CRANK, running:PIN or treadmill:PIN.", "station"));
+    parser.addOption(QCommandLineOption("distance-per-revolution", "Treadmill belt travel per sensor revolution in millimeters, above 0.", "mm", QString::number(DISTANCE_PER_REVOLUTION)));
+    parser.addOption(QCommandLineOption("speed-window", "Running speed is averaged over at most this many milliseconds of belt edges.", "ms", QString::number(SpeedEstimator::Settings().windowNanos / 1000000)));
+    parser.addOption(QCommandLineOption("speed-window-edges", "Running speed is averaged over at most this many belt edges.", "edges", QString::number(SpeedEstimator::Settings().windowEdges)));
+    parser.addOption(QCommandLineOption("speed-smoothing", "Weight of the newest running speed between 0 (exclusive) and 1.", "weight", QString::number(SpeedEstimator::Settings().smoothing / 256.0)));
+    parser.addOption(QCommandLineOption("speed-stop-periods", "Running speed reads zero after this many edge periods without an edge, 0 holds it until the stop timeout.", "periods", QString::number(SpeedEstimator::Settings().stopPeriods)));
+    parser.addOption(QCommandLineOption("estimate-cadence", "The daemon ran with --estimate-cadence."));
+    parser.addOption(QCommandLineOption("coalesce-window", "The daemon's --coalesce-window in milliseconds.", "ms", QString::number(NotificationScheduler::Settings().coalesceWindowMillis)));
+    parser.addOption(QCommandLineOption("keep-alive", "The daemon's --keep-alive in milliseconds.", "ms", QString::number(NotificationScheduler::Settings().keepAliveMillis)));
+    parser.addOption(QCommandLineOption("anomaly-rpm", "Flag edges faster than this, 0 for no limit.", "rpm", QString::number(SessionAnalyzer::Settings().maxRpm)));
+    parser.addOption(QCommandLineOption("jump-factor", "Flag rpm changing by more than this factor from one revolution to the next.", "factor", QString::number(SessionAnalyzer::Settings().jumpFactor)));
+    parser.addOption(QCommandLineOption("jump-min-rpm", "Only look for jumps while both revolutions are faster than this.", "rpm", QString::number(SessionAnalyzer::Settings().jumpMinRpm)));
+    parser.addOption(QCommandLineOption("gap", "Flag a sensor silent for longer than this many milliseconds.", "ms", QString::number(SessionAnalyzer::Settings().gapNanos / 1000000)));
+    parser.addOption(QCommandLineOption("list-anomalies", "Anomalies listed per session, the rest are only counted.", "count", QString::number(SessionAnalyzer::Settings().maxListedAnomalies)));
+    parser.addOption(QCommandLineOption("notifications", "Write the replayed notifications of every session to RECORDING.SESSION.csv in this directory; the recordings need distinct file names.", "directory"));
+    parser.addOption(QCommandLineOption("jobs", "Recordings analyzed at the same time, 0 for one per CPU.", "count", "0"));
+    parser.process(app);
+    const QStringList recordings = parser.positionalArguments();
+    if (recordings.isEmpty())
+        parser.showHelp(1);
+
+    SessionAnalyzer::Settings settings;
+    if (!parseSettings(parser, &settings))
+        return 1;
+    bool ok = true;
+    int jobs = intValue(parser, "jobs", &ok);
+    if (!ok)
+        return 1;
+    if (jobs <= 0)
+        jobs = int(qMax(1u, std::thread::hardware_concurrency()));
+    jobs = qMin(jobs, recordings.size());
+    const QString notificationDirectory = parser.value(QStringLiteral("notifications"));
+
+    // THE CSV FILES ARE NAMED AFTER THE RECORDING, SO TWO RECORDINGS OF THE SAME NAME FROM
+    // DIFFERENT DIRECTORIES WOULD OVERWRITE EACH OTHER'S, FROM TWO WORKERS AT ONCE
+    if (!notificationDirectory.isEmpty())
+    {
+        QStringList names;
+        for (const QString &recording : recordings)
+        {
+            const QString name = QFileInfo(recording).fileName();
+            if (names.contains(name))
+            {
+                qWarning() << "more than one recording named" << name << "for --notifications, analyze them separately";
+                return 1;
+            }
+            names << name;
+        }
+    }
+
+    // EVERY WORKER TAKES THE NEXT RECORDING NOBODY HAS TAKEN, SO A LONG ONE DOES NOT HOLD UP
+    // THE REST.  THE REPORTS ARE PRINTED IN THE ORDER OF THE COMMAND LINE
+    const SessionAnalyzer analyzer(settings);
+    std::vector<Result> results(size_t(recordings.size()));
+    std::atomic<int> next(0);
+    std::vector<std::thread> workers;
+    for (int i = 0; i < jobs; ++i)
+    {
+        workers.emplace_back([&]() {
+            for (int index = next++; index < recordings.size(); index = next++)
+                results[size_t(index)] = analyzeFile(analyzer, recordings.at(index), notificationDirectory);
+        });
+    }
+    for (std::thread &worker : workers)
+        worker.join();
+
+    int exitCode = 0;
+    for (const Result &result : results)
+    {
+        if (result.report)
+            fwrite(result.report, 1, result.size, stdout);
+        free(result.report);
+        if (!result.complete)
+            exitCode = 1;
+    }
+    return exitCode;
+}
@@ -0,0 +1,17 @@
+TEMPLATE = app
+TARGET = session-analyzer.bin
+
+QT = core bluetooth
+CONFIG += c++11 console
+
+HEADERS += sessionanalyzer.h
+
+SOURCES += main.cpp \
+           sessionanalyzer.cpp
+
+# THE SERVICES ENCODE THE REPLAYED NOTIFICATIONS, SO THEY NEED THE BLUETOOTH MODULE BUT NO
+# ADAPTER.  NOTHING HERE TOUCHES GPIO
+include(../common/common-sources.pri)
+
+target.path = .
+INSTALLS += target
@@ -0,0 +1,511 @@
+#include "sessionanalyzer.h"
+#include "cscservice.h"
+#include "ftmsservice.h"
+#include "rscservice.h"
+#include "sessionreader.h"
+#include "simulatedsensorinput.h"
+
+#include <QtCore/qbytearray.h>
+#include <QtCore/qdatetime.h>
+#include <QtCore/qscopedpointer.h>
+#include <QtCore/qstringlist.h>
+#include <QtCore/qvector.h>
+#include <cstring>
+#include <deque>
+#include <limits>
+
+namespace
+{
+enum
+{
+    MAX_PINS = 64
+};
+// A PERIOD LONGER THAN THIS IS STANDING STILL, AS FOR THE SERVICES
+const qint64 STOP_TIMEOUT_NANOS = 2000000000;
+// A RECORDED NOTIFICATION IS AT MOST THIS LATE AGAINST THE REPLAYED ONE (COALESCING, TIMER
+// LATENESS, A BUSY EVENT LOOP).  UNMATCHED CHANGES OLDER THAN THIS ARE GIVEN UP ON
+const qint64 MATCH_SLACK_NANOS = 1000000000;
+const char *const PIN_NAMES[][2] = { { "wheel", "crank" }, { "belt", "" }, { "belt", "" } };
+
+enum AnomalyKind
+{
+    TooFast,
+    Jump,
+    Gap,
+    Backwards,
+    Unrouted,
+    ANOMALY_KINDS
+};
+const char *const ANOMALY_NAMES[] = { "too fast", "rpm jump", "gap", "time backwards", "unrouted edge" };
+
+int pinValue(const QString &text, bool *ok)
+{
+    bool valid = false;
+    const int pin = text.toInt(&valid);
+    *ok = *ok && valid && pin >= 0 && pin < MAX_PINS;
+    return pin;
+}
+
+double rpmOf(qint64 periodNanos)
+{
+    return periodNanos > 0 ? 60e9 / double(periodNanos) : 0;
+}
+
+// CHANGES OF ONE STATION'S NOTIFICATION PAYLOAD, REPLAYED AGAINST RECORDED, MATCHED AS THEY
+// COME.  KEEP-ALIVES ONLY REPEAT THE LAST PAYLOAD, AND HOW MANY THERE ARE DEPENDS ON WHEN A
+// CENTRAL WAS SUBSCRIBED, SO ONLY CHANGES ARE COMPARED.  BOTH STREAMS ARE IN TIME ORDER AND A
+// RECORDED CHANGE NEVER COMES BEFORE ITS REPLAYED ONE, SO WHEN THE OLDEST OF EACH DIFFER THE
+// OLDER ONE HAS NO PARTNER (E.G. TWO EDGES COALESCED INTO ONE NOTIFICATION ON ONE SIDE ONLY)
+class ChangeMatcher
+{
+public:
+    void replayed(qint64 nanos, const char *payload, int size) { add(replay, lastReplayed, &replayedChanges, nanos, payload, size); }
+    void recorded(qint64 nanos, const char *payload, int size) { add(record, lastRecorded, &recordedChanges, nanos, payload, size); }
+
+    quint64 replayedChanges = 0;
+    quint64 recordedChanges = 0;
+    quint64 matched = 0;
+
+private:
+    struct Change
+    {
+        qint64 nanos;
+        QByteArray payload;
+    };
+
+    void add(std::deque<Change> &queue, QByteArray &last, quint64 *changes, qint64 nanos, const char *payload, int size)
+    {
+        // RECORDINGS CUT PAYLOADS TO MAX_PAYLOAD BYTES, SO ONLY THOSE ARE COMPARED
+        const QByteArray value(payload, qMin(size, int(SessionLog::MAX_PAYLOAD)));
+        if (value == last)
+            return;
+        last = value;
+        ++*changes;
+        queue.push_back(Change { nanos, value });
+        match(nanos);
+    }
+
+    void match(qint64 now)
+    {
+        while (!replay.empty() && !record.empty())
+        {
+            if (replay.front().payload == record.front().payload)
+            {
+                ++matched;
+                replay.pop_front();
+                record.pop_front();
+            }
+            else if (record.front().nanos < replay.front().nanos)
+            {
+                record.pop_front();
+            }
+            else
+            {
+                replay.pop_front();
+            }
+        }
+        // NOBODY SUBSCRIBED: NOTHING WAS RECORDED AND THE REPLAY WOULD PILE UP
+        while (!replay.empty() && now - replay.front().nanos > MATCH_SLACK_NANOS)
+            replay.pop_front();
+    }
+
+    std::deque<Change> replay;
+    std::deque<Change> record;
+    QByteArray lastReplayed;
+    QByteArray lastRecorded;
+};
+}
+
+// ONE SESSION: ITS SERVICES ON A MANUAL CLOCK, MOVED TO EVERY RECORDED TIMESTAMP IN TURN
+class SessionAnalyzer::Replay
+{
+public:
+    Replay(const Settings &settings, qint64 startNanos, FILE *notifications);
+    ~Replay();
+
+    void edge(int pin, qint64 nanos);
+    void recordedNotification(quint16 characteristic, qint64 nanos, const char *payload, int size);
+    // THE COUNTERS THE DAEMON RESTORED FOR A STATION FROM ITS STATE FILE, BEFORE ITS FIRST EDGE
+    void restoredCounters(quint16 characteristic, int pin, const quint32 *values, int count);
+    // RUNS THE TIMERS UP TO THE LAST RECORD OF THE SESSION
+    void finish();
+    void report(FILE *out) const;
+    // THE LATEST RECORDED TIMESTAMP
+    qint64 endNanos() const { return lastNanos; }
+    quint64 edgeCount() const { return edges; }
+
+private:
+    struct PinStats
+    {
+        quint64 edges = 0;
+        qint64 lastEdge = -1;
+        qint64 period = -1;
+        qint64 minPeriod = std::numeric_limits<qint64>::max();
+        // PERIODS SHORTER THAN THE STOP TIMEOUT, AND THEIR SUM
+        quint64 movingPeriods = 0;
+        qint64 movingNanos = 0;
+    };
+    struct StationState
+    {
+        quint16 characteristic;
+        // NO OTHER STATION NOTIFIES THE SAME CHARACTERISTIC, SO THE RECORDING TELLS THEM APART
+        bool comparable;
+        // COUNTERS RECORDS APPLIED, ONE WHEN THE DAEMON KEPT A STATE FILE
+        int restored = 0;
+        quint64 replayed = 0;
+        quint64 recorded = 0;
+        ChangeMatcher changes;
+    };
+    struct Anomaly
+    {
+        qint64 nanos;
+        int pin;
+        char text[64];
+    };
+
+    void moveClockTo(qint64 nanos);
+    void sent(int station, const QByteArray &value);
+    void flag(AnomalyKind kind, qint64 nanos, int pin, const char *format, double first, double second = 0);
+
+    const Settings &settings;
+    const qint64 startNanos;
+    FILE *const notifications;
+    SimulatedSensorInput clock;
+    qint64 clockNanos;
+    qint64 lastNanos;
+    QList<MeasurementService *> services;
+    QVector<StationState> stations;
+    // STATIONS FED BY EACH PIN
+    QVector<QList<int>> routes;
+    PinStats pins[MAX_PINS];
+    quint64 edges = 0;
+    quint64 unknownNotifications = 0;
+    quint64 anomalyCounts[ANOMALY_KINDS] = {};
+    QVector<Anomaly> anomalies;
+};
+
+SessionAnalyzer::Replay::Replay(const Settings &settings, qint64 startNanos, FILE *notifications)
+    : settings(settings), startNanos(startNanos), notifications(notifications), clock(SimulatedSensorInput::ManualClock),
+      clockNanos(startNanos), lastNanos(startNanos), routes(MAX_PINS)
+{
+    // THE SERVICES SEE THE RECORDED CLOCK, SO EVENT TIMES ENCODE AS THEY DID LIVE
+    clock.advance(startNanos);
+    for (const Station &station : settings.stations)
+    {
+        MeasurementService *service;
+        if (station.kind == Station::Cycling)
+            service = new CscService(clock, station.pins[0], station.pins[1], nullptr);
+        else if (station.kind == Station::Running)
+            service = new RscService(clock, station.pins[0], settings.distancePerRevolution, settings.speed, settings.estimateCadence, nullptr);
+        else
+            service = new FtmsService(clock, station.pins[0], settings.distancePerRevolution, settings.speed);
+        const int index = services.size();
+        services << service;
+        for (int pin : service->pins())
+            routes[pin] << index;
+        // THE SINK STANDS IN FOR A CENTRAL SUBSCRIBED ALL SESSION LONG
+        service->setSink([this, index](const QByteArray &value) { sent(index, value); });
+        service->timeOnSensorClock();
+        service->startReporting(settings.scheduling);
+
+        StationState state;
+        state.characteristic = service->measurementCharacteristic();
+        state.comparable = true;
+        for (StationState &other : stations)
+        {
+            if (other.characteristic == state.characteristic)
+                other.comparable = state.comparable = false;
+        }
+        stations << state;
+    }
+}
+
+SessionAnalyzer::Replay::~Replay()
+{
+    qDeleteAll(services);
+}
+
+void SessionAnalyzer::Replay::moveClockTo(qint64 nanos)
+{
+    // EVERY TIMER DUE BY THEN FIRES FIRST, AT ITS DUE TIME, OLDEST FIRST
+    for (;;)
+    {
+        int next = -1;
+        qint64 due = nanos;
+        for (int i = 0; i < services.size(); ++i)
+        {
+            const qint64 serviceDue = services.at(i)->timedSendDueNanos();
+            if (serviceDue >= 0 && serviceDue <= due)
+            {
+                next = i;
+                due = serviceDue;
+            }
+        }
+        if (next < 0)
+            break;
+        clock.advance(qMax(due, clockNanos) - clockNanos);
+        clockNanos = qMax(due, clockNanos);
+        services.at(next)->runTimedSend();
+    }
+    clock.advance(qMax(nanos, clockNanos) - clockNanos);
+    clockNanos = qMax(nanos, clockNanos);
+}
+
+void SessionAnalyzer::Replay::edge(int pin, qint64 nanos)
+{
+    ++edges;
+    if (nanos < lastNanos)
+        flag(Backwards, nanos, pin, "%.0f us", double(lastNanos - nanos) / 1e3);
+    lastNanos = qMax(lastNanos, nanos);
+    if (pin < 0 || pin >= MAX_PINS || routes.at(pin).isEmpty())
+    {
+        flag(Unrouted, nanos, pin, "no station on this pin", 0);
+        return;
+    }
+
+    PinStats &stats = pins[pin];
+    if (stats.lastEdge >= 0)
+    {
+        const qint64 period = nanos - stats.lastEdge;
+        // A PERIOD FLAGGED AS TOO FAST IS NOT THE FASTEST THE SENSOR WENT
+        const bool tooFast = settings.maxRpm > 0 && rpmOf(period) > settings.maxRpm;
+        if (tooFast)
+            flag(TooFast, nanos, pin, "%.0f rpm", rpmOf(period));
+        if (period > settings.gapNanos)
+            flag(Gap, nanos, pin, "no edge for %.1f s", double(period) / 1e9);
+        const double minPeriod = 60e9 / settings.jumpMinRpm;
+        if (stats.period > 0 && period > 0 && double(stats.period) < minPeriod && double(period) < minPeriod
+            && (double(stats.period) > double(period) * settings.jumpFactor || double(period) > double(stats.period) * settings.jumpFactor))
+            flag(Jump, nanos, pin, "%.0f -> %.0f rpm", rpmOf(stats.period), rpmOf(period));
+        if (period > 0 && !tooFast)
+            stats.minPeriod = qMin(stats.minPeriod, period);
+        if (period < STOP_TIMEOUT_NANOS)
+        {
+            ++stats.movingPeriods;
+            stats.movingNanos += period;
+        }
+        stats.period = period;
+    }
+    ++stats.edges;
+    stats.lastEdge = nanos;
+
+    moveClockTo(nanos);
+    for (int station : routes.at(pin))
+        services.at(station)->handleEdge(pin, nanos);
+}
+
+void SessionAnalyzer::Replay::recordedNotification(quint16 characteristic, qint64 nanos, const char *payload, int size)
+{
+    lastNanos = qMax(lastNanos, nanos);
+    for (StationState &station : stations)
+    {
+        if (station.characteristic != characteristic)
+            continue;
+        ++station.recorded;
+        // THE REPLAYED CHANGES UP TO THIS MOMENT MUST BE QUEUED BEFORE THE RECORDED ONE
+        moveClockTo(nanos);
+        if (station.comparable)
+            station.changes.recorded(nanos, payload, size);
+        return;
+    }
+    ++unknownNotifications;
+}
+
+void SessionAnalyzer::Replay::restoredCounters(quint16 characteristic, int pin, const quint32 *values, int count)
+{
+    quint32 restored[SessionLog::MAX_COUNTERS] = {};
+    memcpy(restored, values, sizeof(quint32) * size_t(qBound(0, count, int(SessionLog::MAX_COUNTERS))));
+    for (int i = 0; i < services.size(); ++i)
+    {
+        MeasurementService *service = services.at(i);
+        if (stations.at(i).characteristic == characteristic && service->pins().first() == pin)
+        {
+            service->restoreCounters(restored);
+            ++stations[i].restored;
+            return;
+        }
+    }
+}
+
+void SessionAnalyzer::Replay::finish()
+{
+    moveClockTo(lastNanos);
+}
+
+void SessionAnalyzer::Replay::sent(int station, const QByteArray &value)
+{
+    StationState &state = stations[station];
+    ++state.replayed;
+    if (state.comparable)
+        state.changes.replayed(clockNanos, value.constData(), value.size());
+    if (!notifications)
+        return;
+    fprintf(notifications, "%lld,%d,0x%04x,", static_cast<long long>(clockNanos - startNanos), station, state.characteristic);
+    for (int i = 0; i < value.size(); ++i)
+        fprintf(notifications, "%02x", uchar(value.at(i)));
+    fputc('\n', notifications);
+}
+
+void SessionAnalyzer::Replay::flag(AnomalyKind kind, qint64 nanos, int pin, const char *format, double first, double second)
+{
+    ++anomalyCounts[kind];
+    if (anomalies.size() >= settings.maxListedAnomalies)
+        return;
+    Anomaly anomaly;
+    anomaly.nanos = nanos;
+    anomaly.pin = pin;
+    const int written = snprintf(anomaly.text, sizeof(anomaly.text), "%s: ", ANOMALY_NAMES[kind]);
+    snprintf(anomaly.text + written, sizeof(anomaly.text) - size_t(written), format, first, second);
+    anomalies << anomaly;
+}
+
+void SessionAnalyzer::Replay::report(FILE *out) const
+{
+    for (int i = 0; i < services.size(); ++i)
+    {
+        const Station &station = settings.stations.at(i);
+        fprintf(out, "  %s %d:", services.at(i)->name(), i);
+        for (int p = 0; p < 2; ++p)
+        {
+            const int pin = station.pins[p];
+            if (pin < 0)
+                continue;
+            const PinStats &stats = pins[pin];
+            const double maxRpm = stats.minPeriod < std::numeric_limits<qint64>::max() ? rpmOf(stats.minPeriod) : 0;
+            const double movingRpm = stats.movingNanos > 0 ? 60e9 * double(stats.movingPeriods) / double(stats.movingNanos) : 0;
+            fprintf(out, "  %s (pin %d) %llu rev, moving %.1f s at %.1f rpm, max %.1f rpm", PIN_NAMES[station.kind][p], pin,
+                    static_cast<unsigned long long>(stats.edges), double(stats.movingNanos) / 1e9, movingRpm, maxRpm);
+            if (station.kind != Station::Cycling)
+            {
+                // MILLIMETERS PER REVOLUTION TIMES RPM / 60000 IS M/S
+                fprintf(out, ", %.1f m, moving %.2f m/s, max %.2f m/s", double(stats.edges) * settings.distancePerRevolution / 1000,
+                        movingRpm * settings.distancePerRevolution / 60000, maxRpm * settings.distancePerRevolution / 60000);
+            }
+        }
+        const StationState &state = stations.at(i);
+        fprintf(out, "\n      notifications: %llu replayed%s, %llu recorded", static_cast<unsigned long long>(state.replayed),
+                state.restored ? " from the counters of the state file" : "", static_cast<unsigned long long>(state.recorded));
+        if (!state.comparable)
+            fputs(", not compared (another station notifies the same characteristic)\n", out);
+        else if (state.recorded == 0)
+            fputs(", nothing recorded to compare (no central subscribed)\n", out);
+        else
+            fprintf(out, ", %llu of %llu recorded changes match the replay (%llu replayed)\n",
+                    static_cast<unsigned long long>(state.changes.matched),
+                    static_cast<unsigned long long>(state.changes.recordedChanges),
+                    static_cast<unsigned long long>(state.changes.replayedChanges));
+    }
+    if (unknownNotifications)
+        fprintf(out, "  %llu recorded notifications of no configured station\n", static_cast<unsigned long long>(unknownNotifications));
+
+    quint64 total = 0;
+    for (quint64 count : anomalyCounts)
+        total += count;
+    if (total == 0)
+    {
+        fputs("  no anomalies\n", out);
+        return;
+    }
+    fputs("  anomalies:", out);
+    for (int kind = 0; kind < ANOMALY_KINDS; ++kind)
+    {
+        if (anomalyCounts[kind])
+            fprintf(out, " %llu %s", static_cast<unsigned long long>(anomalyCounts[kind]), ANOMALY_NAMES[kind]);
+    }
+    fputc('\n', out);
+    for (const Anomaly &anomaly : anomalies)
+        fprintf(out, "    %12.3f s  pin %2d  %s\n", double(anomaly.nanos - startNanos) / 1e9, anomaly.pin, anomaly.text);
+    if (total > quint64(anomalies.size()))
+        fprintf(out, "    ... %llu more\n", static_cast<unsigned long long>(total - quint64(anomalies.size())));
+}
+
+SessionAnalyzer::SessionAnalyzer(const Settings &settings)
+    : settings(settings)
+{
+}
+
+bool SessionAnalyzer::parseStation(const QString &specification, Station *station)
+{
+    // THE DAEMON'S --station WITHOUT A PERIPHERAL: KIND:PINS
+    const QStringList parts = specification.split(QLatin1Char(':'));
+    bool ok = true;
+    const QString kind = parts.first();
+    if (kind == QLatin1String("speed-cadence") && parts.size() == 3)
+        *station = Station { Station::Cycling, { pinValue(parts.at(1), &ok), pinValue(parts.at(2), &ok) } };
+    else if (kind == QLatin1String("speed") && parts.size() == 2)
+        *station = Station { Station::Cycling, { pinValue(parts.at(1), &ok), -1 } };
+    else if (kind == QLatin1String("cadence") && parts.size() == 2)
+        *station = Station { Station::Cycling, { -1, pinValue(parts.at(1), &ok) } };
+    else if (kind == QLatin1String("running") && parts.size() == 2)
+        *station = Station { Station::Running, { pinValue(parts.at(1), &ok), -1 } };
+    else if (kind == QLatin1String("treadmill") && parts.size() == 2)
+        *station = Station { Station::Treadmill, { pinValue(parts.at(1), &ok), -1 } };
+    else
+        return false;
+    return ok;
+}
+
+bool SessionAnalyzer::analyze(const char *data, qint64 size, const QString &name, FILE *report, const QString &notifications) const
+{
+    // ONE EVENT AT A TIME, AND ONLY THE CURRENT SESSION'S STATE, HOWEVER LONG THE RECORDING IS
+    SessionReader reader(data, size);
+    SessionReader::Event event;
+    QScopedPointer<Replay> replay;
+    FILE *notificationFile = nullptr;
+    qint64 sessionStart = 0;
+    qint64 sessionWallClock = 0;
+    int session = 0;
+
+    const auto endSession = [&]() {
+        if (!replay)
+            return;
+        replay->finish();
+        fprintf(report, "%s session %d: started %s, %.1f s, %llu edges\n", name.toLocal8Bit().constData(), session,
+                QDateTime::fromMSecsSinceEpoch(sessionWallClock / 1000000, Qt::UTC).toString(Qt::ISODate).toLocal8Bit().constData(),
+                double(replay->endNanos() - sessionStart) / 1e9, static_cast<unsigned long long>(replay->edgeCount()));
+        replay->report(report);
+        replay.reset();
+        if (notificationFile)
+            fclose(notificationFile);
+        notificationFile = nullptr;
+    };
+
+    while (reader.next(event))
+    {
+        if (event.type == SessionLog::SessionRecord)
+        {
+            endSession();
+            session = event.session;
+            sessionStart = event.timestampNanos;
+            sessionWallClock = event.wallClockNanos;
+            if (!notifications.isEmpty())
+            {
+                const QString fileName = notifications + QLatin1Char('.') + QString::number(session) + QLatin1String(".csv");
+                notificationFile = fopen(fileName.toLocal8Bit().constData(), "w");
+                if (notificationFile)
+                    fputs("elapsed_ns,station,characteristic,payload\n", notificationFile);
+                else
+                    fprintf(report, "%s: cannot write %s\n", name.toLocal8Bit().constData(), fileName.toLocal8Bit().constData());
+            }
+            replay.reset(new Replay(settings, sessionStart, notificationFile));
+        }
+        else if (event.type == SessionLog::EdgeRecord)
+        {
+            replay->edge(event.pin, event.timestampNanos);
+        }
+        else if (event.type == SessionLog::CountersRecord)
+        {
+            replay->restoredCounters(event.characteristic, event.pin, event.counters, event.size);
+        }
+        else
+        {
+            replay->recordedNotification(event.characteristic, event.timestampNanos, event.payload, event.size);
+        }
+    }
+    endSession();
+    if (session == 0)
+        fprintf(report, "%s: no sessions\n", name.toLocal8Bit().constData());
+    if (reader.truncated())
+        fprintf(report, "%s: ends in an incomplete record, the rest is not analyzed\n", name.toLocal8Bit().constData());
+    return !reader.truncated();
+}
@@ -0,0 +1,69 @@
+#ifndef SESSIONANALYZER_H
+#define SESSIONANALYZER_H
+
+#include "notificationscheduler.h"
+#include "speedestimator.h"
+
+#include <QtCore/qlist.h>
+#include <QtCore/qstring.h>
+#include <cstdio>
+
+// REPLAYS THE EDGES OF A SESSION RECORDING THROUGH THE SAME SERVICES THE DAEMON RUNS, SO THE
+// SPEED, CADENCE AND ENCODED NOTIFICATIONS ARE BYTE FOR BYTE WHAT A SUBSCRIBED CENTRAL WOULD
+// HAVE GOT.  THE NOTIFICATION TIMERS RUN ON THE RECORDED CLOCK AND FIRE EXACTLY WHEN DUE.
+// ALONG THE WAY IT SUMS UP EVERY SESSION, FLAGS EDGES NO REAL WHEEL OR BELT COULD MAKE AND
+// COMPARES THE REPLAYED NOTIFICATIONS WITH THE ONES THE DAEMON RECORDED.
+//
+// ONE ANALYZER READS ONE RECORDING AT A TIME AND KEEPS NO STATE BETWEEN THEM, SO SEVERAL
+// RECORDINGS ARE ANALYZED IN PARALLEL WITH ONE ANALYZER PER THREAD.
+class SessionAnalyzer
+{
+public:
+    struct Station
+    {
+        enum Kind
+        {
+            Cycling,
+            Running,
+            Treadmill
+        } kind;
+        // CYCLING: WHEEL AND CRANK, RUNNING AND TREADMILL: BELT.  -1 WHEN NOT FITTED
+        int pins[2];
+    };
+    struct Settings
+    {
+        // AS GIVEN TO THE DAEMON THAT RECORDED THE SESSIONS
+        QList<Station> stations;
+        int distancePerRevolution = 133;
+        SpeedEstimator::Settings speed;
+        bool estimateCadence = false;
+        NotificationScheduler::Settings scheduling;
+        // ANOMALIES: AN EDGE PERIOD FASTER THAN THIS
+        int maxRpm = 3000;
+        // RPM CHANGING BY MORE THAN THIS FACTOR FROM ONE PERIOD TO THE NEXT, WHILE BOTH ARE
+        // FASTER THAN jumpMinRpm (STARTING FROM STANDSTILL IS ALWAYS A JUMP)
+        double jumpFactor = 2;
+        int jumpMinRpm = 30;
+        // A PIN SILENT FOR THIS LONG BETWEEN TWO EDGES
+        qint64 gapNanos = 10000000000LL;
+        // ANOMALIES LISTED PER SESSION, THE REST ARE ONLY COUNTED
+        int maxListedAnomalies = 20;
+    };
+
+    explicit SessionAnalyzer(const Settings &settings);
+
+    // "speed:PIN", "cadence:PIN", "speed-cadence:WHEEL:CRANK", "running:PIN", "treadmill:PIN"
+    static bool parseStation(const QString &specification, Station *station);
+
+    // WRITES THE REPORT OF EVERY SESSION IN THE RECORDING TO report.  WITH A NOTIFICATIONS
+    // PREFIX, EACH SESSION'S REPLAYED NOTIFICATIONS ALSO GO TO "<PREFIX>.<SESSION>.csv".
+    // FALSE WHEN THE RECORDING ENDS IN A RECORD THAT CANNOT BE READ
+    bool analyze(const char *data, qint64 size, const QString &name, FILE *report, const QString &notifications) const;
+
+private:
+    class Replay;
+
+    const Settings settings;
+};
+
+#endif // SESSIONANALYZER_H
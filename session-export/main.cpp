@@ -0,0 +1,86 @@
+#include "sessionreader.h"
+
+#include <QtCore/qcommandlineparser.h>
+#include <QtCore/qcoreapplication.h>
+#include <QtCore/qfile.h>
+#include <QtCore/qloggingcategory.h>
+#include <cstdio>
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Writes a session recording as CSV, one row per edge or notification.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("recording", "Session recording written with --record.");
+    parser.addOption(QCommandLineOption("output", "CSV file to write instead of standard output.", "file"));
+    parser.process(app);
+    if (parser.positionalArguments().size() != 1)
+        parser.showHelp(1);
+
+    QFile input(parser.positionalArguments().first());
+    if (!input.open(QIODevice::ReadOnly))
+    {
+        qWarning() << "cannot open" << input.fileName() << input.errorString();
+        return 1;
+    }
+    FILE *output = stdout;
+    if (parser.isSet("output"))
+    {
+        output = fopen(parser.value("output").toLocal8Bit().constData(), "w");
+        if (!output)
+        {
+            qWarning() << "cannot write" << parser.value("output");
+            return 1;
+        }
+    }
+
+    // ONE EVENT AT A TIME, SO MEMORY STAYS THE SAME HOWEVER LONG THE RECORDING IS
+    SessionReader reader(&input);
+    SessionReader::Event event;
+    quint64 rows = 0;
+    qint64 sessionStart = 0;
+    fputs("session,wall_clock_ns,elapsed_ns,event,pin,characteristic,payload\n", output);
+    while (reader.next(event))
+    {
+        if (event.type == SessionLog::SessionRecord)
+        {
+            sessionStart = event.timestampNanos;
+            continue;
+        }
+        fprintf(output, "%d,%lld,%lld,", event.session, static_cast<long long>(event.wallClockNanos),
+                static_cast<long long>(event.timestampNanos - sessionStart));
+        if (event.type == SessionLog::EdgeRecord)
+        {
+            fprintf(output, "edge,%d,,\n", event.pin);
+        }
+        else if (event.type == SessionLog::CountersRecord)
+        {
+            // THE VALUES RESTORED FROM THE STATE FILE, SPACE SEPARATED IN THE PAYLOAD COLUMN
+            fprintf(output, "counters,%d,0x%04x,", event.pin, event.characteristic);
+            for (int i = 0; i < event.size; ++i)
+                fprintf(output, i ? " %u" : "%u", event.counters[i]);
+            fputc('\n', output);
+        }
+        else
+        {
+            fprintf(output, "notification,,0x%04x,", event.characteristic);
+            for (int i = 0; i < event.size; ++i)
+                fprintf(output, "%02x", uchar(event.payload[i]));
+            fputc('\n', output);
+        }
+        ++rows;
+    }
+    if (reader.truncated())
+        qWarning() << "recording ends in an incomplete record after" << rows << "rows";
+    // A FULL DISK MAY ONLY SHOW WHEN THE LAST BUFFER IS WRITTEN OUT
+    bool written = !ferror(output);
+    if ((output == stdout ? fflush(output) : fclose(output)) != 0)
+        written = false;
+    if (!written)
+    {
+        qWarning() << "cannot write" << (output == stdout ? QStringLiteral("standard output") : parser.value("output"));
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,18 @@
+TEMPLATE = app
+TARGET = session-export.bin
+
+QT = core
+CONFIG += c++11 console
+
+# ONLY THE RECORDING FORMAT IS NEEDED, SO THIS BUILDS ANYWHERE
+INCLUDEPATH += ../common
+DEPENDPATH += ../common
+
+HEADERS += ../common/sessionlog.h \
+           ../common/sessionreader.h
+
+SOURCES += main.cpp \
+           ../common/sessionreader.cpp
+
+target.path = .
+INSTALLS += target
@@ -0,0 +1,92 @@
+#include "telemetryreader.h"
+
+#include <QtCore/qcommandlineparser.h>
+#include <QtCore/qcoreapplication.h>
+#include <QtCore/qloggingcategory.h>
+#include <cstdio>
+#include <time.h>
+#include <unistd.h>
+
+namespace
+{
+// SEVERAL KEEP-ALIVES WITHOUT AN UPDATE
+const qint64 STALE_NANOS = 5000000000LL;
+const char *const KIND_NAMES[] = { "?", "cycling", "running", "treadmill" };
+
+qint64 monotonicNanos()
+{
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return qint64(now.tv_sec) * 1000000000 + now.tv_nsec;
+}
+
+void print(const TelemetryReader &reader, int station, const Telemetry::Values &values)
+{
+    const Telemetry::Kind kind = reader.kind(station);
+    std::printf("%-8s %-9s", reader.label(station), KIND_NAMES[kind <= Telemetry::Treadmill ? kind : 0]);
+    if (kind == Telemetry::Cycling)
+    {
+        std::printf(" wheel %8u rev %7.1f rpm  crank %6u rev %4u rpm", values.wheelRevolutions, values.wheelRpm / 100.0,
+                    values.crankRevolutions, values.cadence);
+    }
+    else
+    {
+        std::printf(" belt %8u rev %6.2f m/s %4u spm %9.1f m", values.wheelRevolutions, values.speed / 256.0, values.cadence,
+                    values.totalDistance / 10.0);
+    }
+    std::printf("  at %.3f s\n", double(values.updatedNanos) / 1e9);
+}
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Prints the live values the sensor daemon publishes with --telemetry, without pairing over Bluetooth.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("name", "Shared-memory segment given to the daemon's --telemetry.");
+    parser.addOption(QCommandLineOption("interval", "Milliseconds between printouts.", "ms", "1000"));
+    parser.addOption(QCommandLineOption("once", "Print every station once and exit."));
+    parser.process(app);
+    if (parser.positionalArguments().size() != 1)
+        parser.showHelp(1);
+    const QByteArray name = parser.positionalArguments().first().toLocal8Bit();
+    const int interval = parser.value("interval").toInt();
+
+    // THE DAEMON MAY START LATER, SO A MISSING SEGMENT IS WAITED FOR UNLESS --once
+    TelemetryReader reader;
+    Telemetry::Values values;
+    qint64 previousNewest = 0;
+    qint64 lastChange = monotonicNanos();
+    for (;;)
+    {
+        if (!reader.isOpen() && !reader.open(name.constData()) && parser.isSet("once"))
+        {
+            qWarning() << "no telemetry segment" << name << "(is the daemon running with --telemetry?)";
+            return 1;
+        }
+        qint64 newest = 0;
+        for (int station = 0; station < reader.stations(); ++station)
+        {
+            if (!reader.read(station, &values))
+                continue;
+            print(reader, station, values);
+            newest = qMax(newest, values.updatedNanos);
+        }
+        if (parser.isSet("once"))
+            return 0;
+        // A RESTARTED DAEMON PUBLISHES INTO A NEW SEGMENT WHILE THE MAPPED ONE KEEPS ITS LAST
+        // VALUES.  IT IS UPDATED AT LEAST EVERY KEEP-ALIVE, SO SILENCE MEANS LOOK AGAIN
+        const qint64 now = monotonicNanos();
+        if (newest != previousNewest)
+            lastChange = now;
+        previousNewest = newest;
+        if (reader.isOpen() && now - lastChange > STALE_NANOS)
+        {
+            reader.close();
+            lastChange = now;
+        }
+        std::fflush(stdout);
+        usleep(useconds_t(interval) * 1000);
+    }
+}
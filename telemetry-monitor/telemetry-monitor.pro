@@ -0,0 +1,21 @@
+TEMPLATE = app
+TARGET = telemetry-monitor.bin
+
+QT = core
+CONFIG += c++11 console
+
+# EXAMPLE READER OF THE DAEMON'S SHARED-MEMORY TELEMETRY, ONLY THE READER IS NEEDED
+INCLUDEPATH += ../common
+DEPENDPATH += ../common
+
+HEADERS += ../common/telemetrylayout.h \
+           ../common/telemetryreader.h
+
+SOURCES += main.cpp \
+           ../common/telemetryreader.cpp
+
+# shm_open LIVES IN librt BEFORE GLIBC 2.34
+LIBS += -lrt
+
+target.path = .
+INSTALLS += target